@@ -0,0 +1,194 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "benchmarks/benchmarks.h"
+
+#include "wallet/wallet_common.h"
+
+#include <QtCore/QLocale>
+
+#include <cstdio>
+#include <random>
+
+namespace Wallet::Benchmarks {
+namespace {
+
+constexpr auto kRandomAmounts = 20000;
+constexpr auto kTimedCalls = 200000;
+
+// FormatAmount() as it was before it moved to native 128-bit integers.
+namespace Legacy {
+
+constexpr auto ipow(const int128 &base, size_t power, const int128 &result = 1) -> int128 {
+  return power < 1 ? result : ipow(base * base, power >> 1u, (power & 0x1u) ? (result * base) : result);
+}
+
+QString SeparateDecimals(int128 num, const QLocale &locale) {
+  QString result = "";
+  int cnt = 0;
+
+  if (num == 0) {
+    return "0";
+  }
+
+  num = boost::multiprecision::abs(num);
+  while (num > 0) {
+    result.insert(0, QString::number(static_cast<int>(num % 10)));
+    num = num / 10;
+    if (num > 0 && ++cnt == 3) {
+      result.insert(0, locale.groupSeparator());
+      cnt = 0;
+    }
+  }
+
+  return result;
+};
+
+QString FillZeros(int128 num, int width, QChar sym) {
+  QString result = "";
+
+  while (num > 0) {
+    result.insert(0, QString::number(static_cast<int>(num % 10)));
+    num = num / 10;
+  }
+
+  while (result.size() < width) {
+    result.insert(0, sym);
+  }
+
+  return result;
+}
+
+FormattedAmount FormatAmount(const int128 &amount, const Ton::Symbol &symbol, FormatFlags flags) {
+  const auto decimals = static_cast<uint32_t>(symbol.decimals());
+  const auto one = ipow(int128{10}, decimals);
+
+  auto result = FormattedAmount();
+  result.token = symbol;
+  const auto amountInt = amount / one;
+  const auto amountFraction = boost::multiprecision::abs(amount) % one;
+  auto roundedFraction = amountFraction;
+  if (flags & FormatFlag::Rounded) {
+    if (boost::multiprecision::abs(amountInt) >= 1'000'000 && (roundedFraction % 1'000'000)) {
+      roundedFraction -= (roundedFraction % 1'000'000);
+    } else if (boost::multiprecision::abs(amountInt) >= 1'000 && (roundedFraction % 1'000)) {
+      roundedFraction -= (roundedFraction % 1'000);
+    }
+  }
+  const auto precise = (roundedFraction == amountFraction);
+  auto fraction = amountFraction;
+  auto zeros = 0u;
+  while (zeros < decimals && fraction % 10u == 0) {
+    fraction /= 10u;
+    ++zeros;
+  }
+  const auto system = QLocale::system();
+  const auto locale = (flags & FormatFlag::Simple) ? QLocale::c() : system;
+  const auto separator = system.decimalPoint();
+
+  result.gramsString = SeparateDecimals(amountInt, locale);
+  if ((flags & FormatFlag::Signed) && amount > 0) {
+    result.gramsString = locale.positiveSign() + result.gramsString;
+  } else if (amount < 0) {
+    result.gramsString = locale.negativeSign() + result.gramsString;
+  }
+  result.full = result.gramsString;
+  if (zeros < decimals) {
+    result.separator = separator;
+    result.nanoString = FillZeros(fraction, decimals - zeros, QChar('0'));
+    if (!precise) {
+      const auto fractionLength =                               //
+          (boost::multiprecision::abs(amountInt) >= 1'000'000)  //
+              ? 3
+              : (boost::multiprecision::abs(amountInt) >= 1'000)  //
+                    ? 6
+                    : decimals;
+      result.nanoString = result.nanoString.mid(0, fractionLength);
+    }
+    result.full += separator + result.nanoString;
+  }
+  return result;
+}
+
+}  // namespace Legacy
+
+[[nodiscard]] std::vector<int128> GenerateAmounts() {
+  auto generator = std::mt19937_64(1);
+  auto result = std::vector<int128>();
+  for (auto i = -2000; i <= 2000; ++i) {
+    result.push_back(i);
+  }
+  for (auto i = 0; i != kRandomAmounts; ++i) {
+    // Up to 128 bits, often with trailing zeros, so that every fraction length shows up.
+    auto amount = int128(generator());
+    const auto words = generator() % 4;
+    for (auto j = 0; j != words; ++j) {
+      amount = (amount << 32) | int128(uint32_t(generator()));
+    }
+    if (words == 3) {
+      amount >>= (generator() % 40);
+    }
+    auto power = int128(1);
+    for (auto zeros = generator() % 20; zeros != 0; --zeros) {
+      power *= 10;
+    }
+    amount = (amount / power) * power;
+    result.push_back((generator() & 1) ? int128(-amount) : amount);
+  }
+  result.push_back(std::numeric_limits<int128>::max());
+  result.push_back(-std::numeric_limits<int128>::max());
+  return result;
+}
+
+}  // namespace
+
+int FormatAmountSuite() {
+  const auto amounts = GenerateAmounts();
+  const auto same = [](const FormattedAmount &a, const FormattedAmount &b) {
+    return (a.gramsString == b.gramsString) && (a.separator == b.separator) && (a.nanoString == b.nanoString) &&
+           (a.full == b.full);
+  };
+
+  auto mismatches = 0;
+  for (const auto decimals : {0, 3, 6, 9, 18, 24}) {
+    const auto symbol = Ton::Symbol::tip3(qstr("BENCH"), decimals, QString());
+    for (auto mask = 0; mask != 8; ++mask) {
+      auto flags = FormatFlags();
+      if (mask & 1) {
+        flags |= FormatFlag::Signed;
+      }
+      if (mask & 2) {
+        flags |= FormatFlag::Rounded;
+      }
+      if (mask & 4) {
+        flags |= FormatFlag::Simple;
+      }
+      for (const auto &amount : amounts) {
+        const auto legacy = Legacy::FormatAmount(amount, symbol, flags);
+        const auto current = FormatAmount(amount, symbol, flags);
+        if (!same(legacy, current) && ++mismatches <= 10) {
+          std::printf("FormatAmount(%s, %d, %d): legacy '%s', current '%s'\n", amount.str().c_str(), decimals, mask,
+                      qPrintable(legacy.full), qPrintable(current.full));
+        }
+      }
+    }
+  }
+
+  for (const auto decimals : {9, 18}) {
+    const auto symbol = Ton::Symbol::tip3(qstr("BENCH"), decimals, QString());
+    const auto count = static_cast<int>(amounts.size());
+    const auto legacy = NanosecondsPerCall(kTimedCalls, [&](int i) {
+      Consume(Legacy::FormatAmount(amounts[i % count], symbol, FormatFlags()).full.size());
+    });
+    const auto current = NanosecondsPerCall(kTimedCalls, [&](int i) {
+      Consume(FormatAmount(amounts[i % count], symbol, FormatFlags()).full.size());
+    });
+    PrintTiming(decimals == 9 ? "FormatAmount, 9 decimals" : "FormatAmount, 18 decimals", legacy, current);
+  }
+  return mismatches;
+}
+
+}  // namespace Wallet::Benchmarks
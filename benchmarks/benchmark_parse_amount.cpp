@@ -0,0 +1,171 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "benchmarks/benchmarks.h"
+
+#include "wallet/wallet_common.h"
+
+#include <QtCore/QLocale>
+
+#include <cstdio>
+#include <random>
+
+namespace Wallet::Benchmarks {
+namespace {
+
+constexpr auto kRandomInputs = 100000;
+constexpr auto kRandomInputLengthMax = 14;
+constexpr auto kTimedCalls = 200000;
+
+// ParseAmountString() as it was before the single pass parser.
+namespace Legacy {
+
+constexpr auto ipow(const int128 &base, size_t power, const int128 &result = 1) -> int128 {
+  return power < 1 ? result : ipow(base * base, power >> 1u, (power & 0x1u) ? (result * base) : result);
+}
+
+std::optional<int128> ParseAmountInt(const QString &trimmed, size_t decimals) {
+  const auto one = ipow(int128{10}, decimals);
+  try {
+    const int128 amount{trimmed.toStdString()};
+    return ((amount <= std::numeric_limits<int128>::max() / one) &&
+            (amount >= std::numeric_limits<int128>::min() / one))
+               ? std::make_optional(amount * one)
+               : std::nullopt;
+  } catch (std::runtime_error &) {
+    return std::nullopt;
+  }
+}
+
+std::optional<int128> ParseAmountFraction(QString trimmed, size_t decimals) {
+  while (trimmed.size() < decimals) {
+    trimmed.append('0');
+  }
+  auto zeros = 0;
+  for (const auto &ch : trimmed) {
+    if (ch == '0') {
+      ++zeros;
+    } else {
+      break;
+    }
+  }
+  if (zeros == trimmed.size()) {
+    return 0;
+  } else if (trimmed.size() > decimals) {
+    return std::nullopt;
+  }
+  try {
+    const int128 value{trimmed.mid(zeros).toStdString()};
+    return (value > 0 && value < ipow(int128{10}, decimals)) ? std::make_optional(value) : std::nullopt;
+  } catch (std::runtime_error &) {
+    return std::nullopt;
+  }
+}
+
+std::optional<int128> ParseAmountString(const QString &amount, size_t decimals) {
+  const auto trimmed = amount.trimmed();
+  const auto separator = QString(QLocale::system().decimalPoint());
+  const auto index1 = trimmed.indexOf('.');
+  const auto index2 = trimmed.indexOf(',');
+  const auto index3 = (separator == "." || separator == ",") ? -1 : trimmed.indexOf(separator);
+  const auto found = (index1 >= 0 ? 1 : 0) + (index2 >= 0 ? 1 : 0) + (index3 >= 0 ? 1 : 0);
+  if (found > 1) {
+    return std::nullopt;
+  }
+  const auto index = (index1 >= 0) ? index1 : (index2 >= 0) ? index2 : index3;
+  const auto used = (index1 >= 0) ? "." : (index2 >= 0) ? "," : separator;
+  auto amountInt = ParseAmountInt(trimmed.mid(0, index), decimals);
+  auto amountFraction = ParseAmountFraction(trimmed.mid(index + used.size()), decimals);
+  if (index < 0 || index == trimmed.size() - used.size()) {
+    return amountInt;
+  } else if (index == 0) {
+    return amountFraction;
+  } else if (!amountFraction || !amountInt) {
+    return std::nullopt;
+  }
+  return *amountInt + (*amountInt < 0 ? (-*amountFraction) : (*amountFraction));
+}
+
+}  // namespace Legacy
+
+// The legacy parser read an integer part with a leading zero as octal and a
+// "0x" prefix as hex, and wrapped around on overflow. The current one reads
+// plain decimal digits and rejects overflow, so these inputs differ on purpose.
+[[nodiscard]] bool KnownDifference(const QString &input, int decimals) {
+  auto trimmed = input.trimmed();
+  if (trimmed.startsWith('-')) {
+    trimmed = trimmed.mid(1);
+  }
+  auto digits = 0;
+  while (digits < trimmed.size() && trimmed[digits] >= '0' && trimmed[digits] <= '9') {
+    ++digits;
+  }
+  return (digits > 1 && trimmed[0] == '0') || trimmed.startsWith(qstr("0x")) || (digits + decimals > 38);
+}
+
+[[nodiscard]] QString Describe(const std::optional<int128> &value) {
+  return value ? QString::fromStdString(value->str()) : qstr("none");
+}
+
+[[nodiscard]] std::vector<QString> GenerateInputs() {
+  const auto alphabet = std::string("0123456789012345678901234567890123456789.,- x");
+  auto generator = std::mt19937_64(3);
+  auto result = std::vector<QString>();
+  result.reserve(kRandomInputs);
+  for (auto i = 0; i != kRandomInputs; ++i) {
+    auto input = std::string();
+    for (auto length = generator() % kRandomInputLengthMax; length != 0; --length) {
+      input.push_back(alphabet[generator() % alphabet.size()]);
+    }
+    result.push_back(QString::fromStdString(input));
+  }
+  return result;
+}
+
+}  // namespace
+
+int ParseAmountSuite() {
+  auto inputs = ReadCorpus(qstr("amounts.txt"));
+  auto mismatches = inputs.empty() ? 1 : 0;
+  const auto random = GenerateInputs();
+  inputs.insert(end(inputs), begin(random), end(random));
+
+  auto known = 0;
+  for (const auto decimals : {0, 3, 9, 18}) {
+    for (const auto &input : inputs) {
+      if (KnownDifference(input, decimals)) {
+        ++known;
+        continue;
+      }
+      const auto legacy = Legacy::ParseAmountString(input, decimals);
+      const auto current = ParseAmountString(input, decimals);
+      if (legacy != current && ++mismatches <= 10) {
+        std::printf("ParseAmountString('%s', %d): legacy %s, current %s\n", qPrintable(input), decimals,
+                    qPrintable(Describe(legacy)), qPrintable(Describe(current)));
+      }
+    }
+  }
+  std::printf("ParseAmountString: %d inputs skipped as known differences\n", known);
+
+  auto generator = std::mt19937_64(4);
+  auto typical = std::vector<QString>();
+  for (auto i = 0; i != 1000; ++i) {
+    typical.push_back(QString::number(1 + generator() % 100000) + ',' + QString::number(generator() % 1000));
+  }
+  for (const auto decimals : {9, 18}) {
+    const auto count = static_cast<int>(typical.size());
+    const auto legacy = NanosecondsPerCall(kTimedCalls, [&](int i) {
+      Consume(Legacy::ParseAmountString(typical[i % count], decimals).has_value());
+    });
+    const auto current = NanosecondsPerCall(kTimedCalls, [&](int i) {
+      Consume(ParseAmountString(typical[i % count], decimals).has_value());
+    });
+    PrintTiming(decimals == 9 ? "ParseAmountString, 9 decimals" : "ParseAmountString, 18 decimals", legacy, current);
+  }
+  return mismatches;
+}
+
+}  // namespace Wallet::Benchmarks
@@ -0,0 +1,57 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "benchmarks/benchmarks.h"
+
+#include <QtCore/QFile>
+
+#include <cstdio>
+
+namespace Wallet::Benchmarks {
+namespace {
+
+volatile int64 Sink = 0;
+
+}  // namespace
+
+void Consume(int64 value) {
+  Sink = Sink + value;
+}
+
+std::vector<QString> ReadCorpus(const QString &name) {
+  auto file = QFile(QString::fromUtf8(LIB_WALLET_BENCHMARKS_CORPUS) + '/' + name);
+  if (!file.open(QIODevice::ReadOnly)) {
+    std::printf("Could not open the corpus '%s'\n", qPrintable(name));
+    return {};
+  }
+  auto result = std::vector<QString>();
+  for (auto line : QString::fromUtf8(file.readAll()).split('\n')) {
+    if (line.endsWith('\r')) {
+      line.chop(1);
+    }
+    if (!line.isEmpty() && !line.startsWith('#')) {
+      result.push_back(line);
+    }
+  }
+  return result;
+}
+
+void PrintTiming(const char *name, double legacy, double current) {
+  std::printf("%-40s legacy %8.0f ns, current %8.0f ns\n", name, legacy, current);
+}
+
+}  // namespace Wallet::Benchmarks
+
+int main(int argc, char *argv[]) {
+  using namespace Wallet::Benchmarks;
+
+  auto mismatches = 0;
+  mismatches += FormatAmountSuite();
+  mismatches += ParseAmountSuite();
+  mismatches += LinksSuite();
+  std::printf("%d mismatches\n", mismatches);
+  return mismatches ? 1 : 0;
+}
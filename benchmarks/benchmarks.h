@@ -0,0 +1,39 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "base/basic_types.h"
+
+#include <chrono>
+
+namespace Wallet::Benchmarks {
+
+// Each suite compares the current implementation with the one it replaced,
+// prints the timings of both and returns the number of mismatches.
+[[nodiscard]] int FormatAmountSuite();
+[[nodiscard]] int ParseAmountSuite();
+[[nodiscard]] int LinksSuite();
+
+// Lines of a file from benchmarks/corpus, without the empty ones and the # comments.
+[[nodiscard]] std::vector<QString> ReadCorpus(const QString &name);
+
+// Keeps the benchmarked results alive, so that the calls are not optimized out.
+void Consume(int64 value);
+
+template <typename Callback>
+[[nodiscard]] double NanosecondsPerCall(int count, Callback &&callback) {
+  const auto started = std::chrono::steady_clock::now();
+  for (auto i = 0; i != count; ++i) {
+    callback(i);
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - started;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / count;
+}
+
+void PrintTiming(const char *name, double legacy, double current);
+
+}  // namespace Wallet::Benchmarks
@@ -39,7 +39,7 @@ AmountLabel::AmountLabel(not_null<QWidget *> parent, rpl::producer<FormattedAmou
     , _large(parent, LargeText(rpl::duplicate(amount)), st.large)
     , _small(parent, SmallText(rpl::duplicate(amount)), st.small)
     , _token(Token(amount))
-    , _diamond(!st.diamond ? nullptr : std::make_unique<LottieAnimation>(parent, LottieFromResource("diamond")))
+    , _diamond(!st.diamond ? nullptr : std::make_unique<LottieAnimation>(parent, "diamond", st.diamond))
     , _tokenIcon(!st.diamond ? nullptr : std::make_unique<Ui::FixedHeightWidget>(parent)) {
   const auto currentToken = _tokenIcon->lifetime().make_state<Ton::Symbol>(Ton::Symbol::ton());
 
@@ -67,9 +67,11 @@ AmountLabel::AmountLabel(not_null<QWidget *> parent, rpl::producer<FormattedAmou
       | rpl::start_with_next(
             [=](QRect clip) {
               QPainter p(_tokenIcon.get());
-              p.drawImage(0, 0, Ui::InlineTokenIcon(*currentToken, _st.tokenIcon));
+              p.drawImage(0, 0, Ui::TokenIcon(*currentToken, _st.tokenIcon));
             },
             _tokenIcon->lifetime());
+
+  Ui::TokenIconsUpdated() | rpl::start_with_next([=] { _tokenIcon->update(); }, _tokenIcon->lifetime());
 }
 
 AmountLabel::~AmountLabel() = default;
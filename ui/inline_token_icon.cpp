@@ -1,16 +1,22 @@
 #include "inline_token_icon.h"
 
 #include "ui/rp_widget.h"
+#include "base/weak_ptr.h"
 #include "qr/qr_generate.h"
 #include "styles/style_wallet.h"
 
 #include <QtGui/QPainter>
+#include <crl/crl_async.h>
+
+#include <mutex>
 
 namespace Ui {
 namespace {
 
 constexpr auto kShareQrSize = 768;
 constexpr auto kShareQrPadding = 16;
+constexpr auto kIconCacheMax = 256;
+constexpr auto kQrCacheSize = 8;
 
 const std::vector<std::pair<int, QString>> &TonVariants() {
   static const auto iconTon = std::vector<std::pair<int, QString>>{
@@ -94,55 +100,143 @@ QString ChooseVariant(const QString &name, int desiredSize) {
   return ChooseVariant(TokenVariants(name), desiredSize);
 }
 
-QImage CreateImage(const QString &variant, int size) {
-  Expects(size > 0);
-  auto result = QImage(":/gui/art/" + variant).scaled(size, size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-  result.setDevicePixelRatio(1.);
+// The unknown token placeholder is keyed by an empty symbol.
+using IconKey = std::tuple<std::optional<Ton::Symbol>, int, int>;
 
-  Ensures(!result.isNull());
+struct IconCache {
+  std::mutex mutex;
+  std::map<IconKey, QImage> ready;
+  std::set<IconKey> decoding;
+  QString customPath;
+  TokenIconCacheStats stats;
+};
+
+[[nodiscard]] IconCache &Cache() {
+  static auto result = IconCache();
   return result;
 }
 
-QImage TonImage(int size) {
-  return CreateImage(ChooseVariant(size), size);
+[[nodiscard]] rpl::event_stream<> &Updates() {
+  static auto result = rpl::event_stream<>();
+  return result;
 }
 
-QImage TokenImage(const QString &name, int size) {
-  return CreateImage(ChooseVariant(name, size), size);
+// Token names come from the on-chain metadata, so only the names which can't
+// leave the icons directory are looked up there.
+[[nodiscard]] QString CustomIconName(const QString &name) {
+  const auto result = name.trimmed().toLower();
+  if (result.isEmpty()) {
+    return QString();
+  }
+  for (const auto ch : result) {
+    if (!(ch >= 'a' && ch <= 'z') && !(ch >= '0' && ch <= '9') && ch != '_' && ch != '-') {
+      return QString();
+    }
+  }
+  return result;
 }
 
-QImage UnknownImage(int size) {
-  return CreateImage(ChooseVariant(UnknownTokenVariants(), size), size);
-}
+[[nodiscard]] QImage Decode(const IconKey &key, const QString &customPath) {
+  const auto &[symbol, size, ratio] = key;
+  Expects(size > 0);
 
-const QImage &Image(const Ton::Symbol &symbol) {
-  static const auto iconTon = TonImage(st::walletTokenIconSize * style::DevicePixelRatio());
-  static const auto iconUnknown = UnknownImage(st::walletTokenIconSize * style::DevicePixelRatio());
+  auto result = QImage();
+  if (!symbol.has_value()) {
+    result = QImage(":/gui/art/" + ChooseVariant(UnknownTokenVariants(), size));
+  } else if (symbol->isTon()) {
+    result = QImage(":/gui/art/" + ChooseVariant(size));
+  } else {
+    const auto name = CustomIconName(symbol->name());
+    if (!customPath.isEmpty() && !name.isEmpty()) {
+      result = QImage(customPath + '/' + name + ".png");
+    }
+    if (result.isNull()) {
+      result = QImage(":/gui/art/" + ChooseVariant(symbol->name(), size));
+    }
+  }
+  result = result.scaled(size, size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+  result.setDevicePixelRatio(ratio);
 
-  static const std::map<QString, QImage> tokenIcons = {
-      {"usdt", TokenImage("USDT", st::walletTokenIconSize * style::DevicePixelRatio())},
-      {"usdc", TokenImage("USDC", st::walletTokenIconSize * style::DevicePixelRatio())},
-      {"dai", TokenImage("DAI", st::walletTokenIconSize * style::DevicePixelRatio())},
-      {"wbtc", TokenImage("WBTC", st::walletTokenIconSize * style::DevicePixelRatio())},
-      {"weth", TokenImage("WETH", st::walletTokenIconSize * style::DevicePixelRatio())},
-      {"wton", TokenImage("wTON", st::walletTokenIconSize * style::DevicePixelRatio())},
-  };
+  Ensures(!result.isNull());
+  return result;
+}
 
-  if (symbol.isTon()) {
-    return iconTon;
+void Store(IconCache &cache, const IconKey &key, const QImage &image) {
+  if (cache.ready.size() >= kIconCacheMax) {
+    cache.ready.clear();
   }
+  cache.ready.emplace(key, image);
+}
 
-  const auto escaped = symbol.name().trimmed().toLower();
-  const auto it = tokenIcons.find(escaped);
-  if (it != tokenIcons.end()) {
-    return it->second;
-  } else {
-    return iconUnknown;
+[[nodiscard]] QImage Resolve(const IconKey &key) {
+  auto &cache = Cache();
+  auto customPath = QString();
+  {
+    const auto lock = std::unique_lock(cache.mutex);
+    const auto i = cache.ready.find(key);
+    if (i != end(cache.ready)) {
+      ++cache.stats.hits;
+      return i->second;
+    }
+    ++cache.stats.misses;
+    customPath = cache.customPath;
   }
+  auto result = Decode(key, customPath);
+
+  const auto lock = std::unique_lock(cache.mutex);
+  Store(cache, key, result);
+  return result;
+}
+
+[[nodiscard]] std::optional<QImage> Request(const IconKey &key) {
+  auto &cache = Cache();
+  auto customPath = QString();
+  {
+    const auto lock = std::unique_lock(cache.mutex);
+    const auto i = cache.ready.find(key);
+    if (i != end(cache.ready)) {
+      ++cache.stats.hits;
+      return i->second;
+    }
+    if (!cache.decoding.emplace(key).second) {
+      return std::nullopt;
+    }
+    ++cache.stats.misses;
+    customPath = cache.customPath;
+  }
+  crl::async([=] {
+    auto image = Decode(key, customPath);
+    {
+      auto &cache = Cache();
+      const auto lock = std::unique_lock(cache.mutex);
+      cache.decoding.erase(key);
+      // Icons decoded for a previous directory are dropped, not stored.
+      if (cache.customPath == customPath) {
+        Store(cache, key, image);
+      }
+    }
+    crl::on_main([] { Updates().fire({}); });
+  });
+  return std::nullopt;
+}
+
+// Text, symbol, module and maximum sizes in points with the pixel ratio,
+// or zero sizes for the image to share.
+using QrKey = std::tuple<QString, Ton::Symbol, int, int, int>;
+
+struct QrCache {
+  std::mutex mutex;
+  std::vector<std::pair<QrKey, QImage>> recent;
+};
+
+[[nodiscard]] QrCache &CachedQrs() {
+  static auto result = QrCache();
+  return result;
 }
 
 void Paint(const Ton::Symbol &kind, QPainter &p, int x, int y) {
-  p.drawImage(QRect(x, y, st::walletTokenIconSize, st::walletTokenIconSize), Image(kind));
+  p.drawImage(QRect(x, y, st::walletTokenIconSize, st::walletTokenIconSize),
+              TokenIcon(kind, st::walletTokenIconSize));
 }
 
 }  // namespace
@@ -152,11 +246,38 @@ void PaintInlineTokenIcon(const Ton::Symbol &symbol, QPainter &p, int x, int y,
 }
 
 QImage InlineTokenIcon(const Ton::Symbol &symbol, int size) {
-  if (symbol.isTon()) {
-    return TonImage(size);
-  } else {
-    return TokenImage(symbol.name(), size);
+  return Resolve(IconKey{symbol, size, 1});
+}
+
+QImage TokenIcon(const Ton::Symbol &symbol, int size) {
+  const auto ratio = style::DevicePixelRatio();
+  if (auto result = Request(IconKey{symbol, size * ratio, ratio})) {
+    return std::move(*result);
   }
+  return Request(IconKey{std::nullopt, size * ratio, ratio}).value_or(QImage());
+}
+
+rpl::producer<> TokenIconsUpdated() {
+  return Updates().events();
+}
+
+void SetCustomTokenIconsPath(const QString &path) {
+  auto &cache = Cache();
+  {
+    const auto lock = std::unique_lock(cache.mutex);
+    if (cache.customPath == path) {
+      return;
+    }
+    cache.customPath = path;
+    cache.ready.clear();
+  }
+  Updates().fire({});
+}
+
+TokenIconCacheStats TokenIconStats() {
+  auto &cache = Cache();
+  const auto lock = std::unique_lock(cache.mutex);
+  return cache.stats;
 }
 
 not_null<RpWidget *> CreateInlineTokenIcon(const Ton::Symbol &symbol, not_null<QWidget *> parent, int x, int y,
@@ -173,28 +294,27 @@ not_null<RpWidget *> CreateInlineTokenIcon(const Ton::Symbol &symbol, not_null<Q
             },
             result->lifetime());
 
+  TokenIconsUpdated() | rpl::start_with_next([=] { result->update(); }, result->lifetime());
+
   return result;
 }
 
-QImage TokenQrExact(const Ton::Symbol &symbol, const Qr::Data &data, int pixel) {
+namespace {
+
+[[nodiscard]] QImage TokenQrExact(const Ton::Symbol &symbol, const Qr::Data &data, int pixel) {
   return Qr::ReplaceCenter(Qr::Generate(data, pixel), Ui::InlineTokenIcon(symbol, Qr::ReplaceSize(data, pixel)));
 }
 
-QImage TokenQr(const Ton::Symbol &symbol, const Qr::Data &data, int pixel, int max = 0) {
+[[nodiscard]] int TokenQrPixel(const Qr::Data &data, int pixel, int max) {
   Expects(data.size > 0);
 
   if (max > 0 && data.size * pixel > max) {
     pixel = std::max(max / data.size, 1);
   }
-  return TokenQrExact(symbol, data, pixel * style::DevicePixelRatio());
-}
-
-QImage TokenQr(const Ton::Symbol &symbol, const QString &text, int pixel, int max) {
-  QImage img;
-  return TokenQr(symbol, Qr::Encode(text), pixel, max);
+  return pixel;
 }
 
-QImage TokenQrForShare(const Ton::Symbol &symbol, const QString &text) {
+[[nodiscard]] QImage GenerateTokenQrForShare(const Ton::Symbol &symbol, const QString &text) {
   const auto data = Qr::Encode(text);
   const auto size = (kShareQrSize - 2 * kShareQrPadding);
   const auto image = TokenQrExact(symbol, data, size / data.size);
@@ -208,4 +328,71 @@ QImage TokenQrForShare(const Ton::Symbol &symbol, const QString &text) {
   return result;
 }
 
+[[nodiscard]] QImage GenerateTokenQr(const QrKey &key) {
+  const auto &[text, symbol, pixel, max, ratio] = key;
+  if (!pixel) {
+    return GenerateTokenQrForShare(symbol, text);
+  }
+  const auto data = Qr::Encode(text);
+  return TokenQrExact(symbol, data, TokenQrPixel(data, pixel, max) * ratio);
+}
+
+[[nodiscard]] QImage ResolveTokenQr(const QrKey &key) {
+  auto &cache = CachedQrs();
+  {
+    const auto lock = std::unique_lock(cache.mutex);
+    const auto i = ranges::find(cache.recent, key, &std::pair<QrKey, QImage>::first);
+    if (i != end(cache.recent)) {
+      // Most recently used go last, so the oldest are evicted first.
+      std::rotate(i, i + 1, end(cache.recent));
+      return cache.recent.back().second;
+    }
+  }
+  auto result = GenerateTokenQr(key);
+
+  const auto lock = std::unique_lock(cache.mutex);
+  if (ranges::find(cache.recent, key, &std::pair<QrKey, QImage>::first) == end(cache.recent)) {
+    if (cache.recent.size() >= kQrCacheSize) {
+      cache.recent.erase(begin(cache.recent));
+    }
+    cache.recent.emplace_back(key, result);
+  }
+  return result;
+}
+
+[[nodiscard]] rpl::producer<QImage> TokenQrValue(const QrKey &key) {
+  return [=](auto consumer) {
+    auto lifetime = rpl::lifetime();
+    const auto guard = lifetime.make_state<base::has_weak_ptr>();
+    crl::async([=] {
+      auto result = ResolveTokenQr(key);
+      crl::on_main(guard, [=, result = std::move(result)]() mutable { consumer.put_next(std::move(result)); });
+    });
+    return lifetime;
+  };
+}
+
+}  // namespace
+
+QImage TokenQr(const Ton::Symbol &symbol, const QString &text, int pixel, int max) {
+  return ResolveTokenQr(QrKey{text, symbol, pixel, max, style::DevicePixelRatio()});
+}
+
+QImage TokenQrForShare(const Ton::Symbol &symbol, const QString &text) {
+  return ResolveTokenQr(QrKey{text, symbol, 0, 0, 1});
+}
+
+rpl::producer<QImage> TokenQrValue(const Ton::Symbol &symbol, const QString &text, int pixel, int max) {
+  return TokenQrValue(QrKey{text, symbol, pixel, max, style::DevicePixelRatio()});
+}
+
+rpl::producer<QImage> TokenQrForShareValue(const Ton::Symbol &symbol, const QString &text) {
+  return TokenQrValue(QrKey{text, symbol, 0, 0, 1});
+}
+
+int TokenQrSize(const QString &text, int pixel, int max) {
+  const auto data = Qr::Encode(text);
+  return data.size * TokenQrPixel(data, pixel, max);
+}
+
 }  // namespace Ui
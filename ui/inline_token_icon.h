@@ -11,12 +11,38 @@ class RpWidget;
 
 void PaintInlineTokenIcon(const Ton::Symbol &symbol, QPainter &p, int x, int y, const style::font &font);
 
+struct TokenIconCacheStats {
+  int64 hits = 0;
+  int64 misses = 0;
+};
+
+// Icons are cached process-wide by symbol, pixel size and pixel ratio.
+// This one has the size in pixels and decodes on the calling thread on a miss.
 [[nodiscard]] QImage InlineTokenIcon(const Ton::Symbol &symbol, int size);
 
+// This one has the size in points and never decodes on the calling thread:
+// the unknown token icon is returned until the decoding on a worker finishes.
+[[nodiscard]] QImage TokenIcon(const Ton::Symbol &symbol, int size);
+[[nodiscard]] rpl::producer<> TokenIconsUpdated();
+
+// Custom token icons are looked up as "<path>/<lowercase name>.png" for the
+// names made of latin letters, digits, '_' and '-' only.
+void SetCustomTokenIconsPath(const QString &path);
+
+[[nodiscard]] TokenIconCacheStats TokenIconStats();
+
 not_null<RpWidget *> CreateInlineTokenIcon(const Ton::Symbol &symbol, not_null<QWidget *> parent, int x, int y,
                                            const style::font &font);
 
+// The last generated codes are cached by text, symbol and size. The values
+// generate on a worker thread and fire once on the main thread.
 [[nodiscard]] QImage TokenQr(const Ton::Symbol &token, const QString &text, int pixel, int max = 0);
 [[nodiscard]] QImage TokenQrForShare(const Ton::Symbol &token, const QString &text);
+[[nodiscard]] rpl::producer<QImage> TokenQrValue(const Ton::Symbol &token, const QString &text, int pixel,
+                                                 int max = 0);
+[[nodiscard]] rpl::producer<QImage> TokenQrForShareValue(const Ton::Symbol &token, const QString &text);
+
+// Side in points of the code TokenQr() generates for the same arguments.
+[[nodiscard]] int TokenQrSize(const QString &text, int pixel, int max = 0);
 
 }  // namespace Ui
@@ -14,12 +14,72 @@
 #include <QtCore/QFile>
 
 namespace Ui {
+namespace {
+
+[[nodiscard]] QString FrameCacheKey(const QString &resource, QSize box) {
+  return resource + '@' + QString::number(box.width()) + 'x' + QString::number(box.height());
+}
+
+[[nodiscard]] base::flat_map<QString, QByteArray> &FrameCache() {
+  static auto result = base::flat_map<QString, QByteArray>();
+  return result;
+}
+
+[[nodiscard]] std::unique_ptr<Lottie::SinglePlayer> MakeCachedPlayer(const QString &resource, QSize box) {
+  const auto key = FrameCacheKey(resource, box);
+  auto get = [=](FnMut<void(QByteArray &&)> done) {
+    const auto i = FrameCache().find(key);
+    done((i != end(FrameCache())) ? QByteArray(i->second) : QByteArray());
+  };
+  auto put = [=](QByteArray &&cached) {
+    crl::on_main([=, cached = std::move(cached)]() mutable { FrameCache()[key] = std::move(cached); });
+  };
+  return std::make_unique<Lottie::SinglePlayer>(std::move(get), std::move(put), LottieFromResource(resource),
+                                                Lottie::FrameRequest{box}, Lottie::Quality::Default);
+}
+
+}  // namespace
 
 LottieAnimation::LottieAnimation(not_null<QWidget *> parent, const QByteArray &content)
+    : LottieAnimation(
+          parent,
+          std::make_unique<Lottie::SinglePlayer>(content, Lottie::FrameRequest(), Lottie::Quality::Synchronous),
+          QSize()) {
+}
+
+LottieAnimation::LottieAnimation(not_null<QWidget *> parent, const QString &resource, int size)
+    : LottieAnimation(parent,
+                      MakeCachedPlayer(resource, QSize(size, size) * style::DevicePixelRatio()),
+                      QSize(size, size) * style::DevicePixelRatio()) {
+}
+
+LottieAnimation::LottieAnimation(not_null<QWidget *> parent, std::unique_ptr<Lottie::SinglePlayer> lottie, QSize box)
     : _widget(std::make_unique<RpWidget>(parent))
-    , _lottie(std::make_unique<Lottie::SinglePlayer>(content, Lottie::FrameRequest(), Lottie::Quality::Synchronous))
+    , _lottie(std::move(lottie))
+    , _box(box)
     , _framesInLoop(_lottie->ready() ? _lottie->information().framesCount : 0) {
-  _lottie->updates() | rpl::start_with_next([=](Lottie::Update update) { _widget->update(); }, _widget->lifetime());
+  init();
+}
+
+LottieAnimation::~LottieAnimation() = default;
+
+void LottieAnimation::init() {
+  _lottie->updates()  //
+      | rpl::start_with_next(
+            [=](Lottie::Update update) {
+              if (!_framesInLoop && _lottie->ready()) {
+                _framesInLoop = _lottie->information().framesCount;
+                if (_stopOnLoop) {
+                  stopOnLoop(_stopOnLoop);
+                }
+              }
+              // The next frame is rendered only after this one is shown, so a
+              // hidden or covered animation pauses here until it is exposed.
+              if (!_widget->visibleRegion().isEmpty()) {
+                _widget->update();
+              }
+            },
+            _widget->lifetime());
 
   _widget->paintRequest() | rpl::filter([=] { return _lottie->ready(); }) |
       rpl::start_with_next([=] { paintFrame(); }, _widget->lifetime());
@@ -27,8 +87,6 @@ LottieAnimation::LottieAnimation(not_null<QWidget *> parent, const QByteArray &c
   _widget->show();
 }
 
-LottieAnimation::~LottieAnimation() = default;
-
 void LottieAnimation::setVisible(bool visible) {
   _widget->setVisible(visible);
 }
@@ -58,16 +116,20 @@ void LottieAnimation::attach(not_null<QWidget *> parent) {
 
 void LottieAnimation::paintFrame() {
   const auto pixelRatio = style::DevicePixelRatio();
-  const auto request = Lottie::FrameRequest{_widget->size() * pixelRatio};
+  const auto request = Lottie::FrameRequest{_box.isEmpty() ? (_widget->size() * pixelRatio) : _box};
   const auto frame = _lottie->frameInfo(request);
-  const auto width = frame.image.width() / pixelRatio;
-  const auto height = frame.image.height() / pixelRatio;
+  const auto size = (frame.image.size() / pixelRatio).scaled(_widget->size(), Qt::KeepAspectRatio);
+  const auto width = size.width();
+  const auto height = size.height();
   const auto left = (_widget->width() - width) / 2;
   const auto top = (_widget->height() - height) / 2;
   const auto destination = QRect{left, top, width, height};
 
   auto p = QPainter(_widget.get());
   p.setOpacity(_opacity);
+  if (!_box.isEmpty()) {
+    p.setRenderHint(QPainter::SmoothPixmapTransform);
+  }
   p.drawImage(destination, frame.image);
 
   if (_startPlaying && frame.index == 0) {
@@ -99,9 +161,14 @@ void LottieAnimation::stopOnLoop(int loop) {
 }
 
 QByteArray LottieFromResource(const QString &name) {
+  static auto cache = base::flat_map<QString, QByteArray>();
+  const auto i = cache.find(name);
+  if (i != end(cache)) {
+    return i->second;
+  }
   auto file = QFile(":/gui/art/lottie/" + name + ".tgs");
   file.open(QIODevice::ReadOnly);
-  return file.readAll();
+  return cache.emplace(name, file.readAll()).first->second;
 }
 
 }  // namespace Ui
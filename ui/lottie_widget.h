@@ -17,7 +17,13 @@ class RpWidget;
 
 class LottieAnimation final {
  public:
+  // Renders synchronously on the main thread at the size of the widget.
   LottieAnimation(not_null<QWidget *> parent, const QByteArray &content);
+
+  // Renders on the shared background thread at a fixed size, scaling the
+  // frames to the widget geometry. Rendered frames are kept by resource and
+  // size, so the next animation of the same loop is neither parsed nor rendered.
+  LottieAnimation(not_null<QWidget *> parent, const QString &resource, int size);
   ~LottieAnimation();
 
   void setVisible(bool visible);
@@ -33,10 +39,14 @@ class LottieAnimation final {
   void stopOnLoop(int loop);
 
  private:
+  LottieAnimation(not_null<QWidget *> parent, std::unique_ptr<Lottie::SinglePlayer> lottie, QSize box);
+
+  void init();
   void paintFrame();
 
   const std::unique_ptr<RpWidget> _widget;
   const std::unique_ptr<Lottie::SinglePlayer> _lottie;
+  const QSize _box;
 
   float64 _opacity = 1.;
   int _stopOnFrame = 0;
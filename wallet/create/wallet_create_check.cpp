@@ -6,6 +6,7 @@
 //
 #include "wallet/create/wallet_create_check.h"
 
+#include "wallet/create/wallet_create_words.h"
 #include "wallet/wallet_phrases.h"
 #include "ui/text/text_utilities.h"
 #include "ui/rp_widget.h"
@@ -68,9 +69,7 @@ void Check::initControls(Fn<std::vector<QString>(QString)> wordsByPrefix, const
   const auto isValid = [=](int index) {
     Expects(index < count);
 
-    const auto word = (*inputs)[index]->word();
-    const auto words = wordsByPrefix(word);
-    return !words.empty() && (words.front() == word);
+    return IsValidWord((*inputs)[index]->word());
   };
   const auto showError = [=](int index) {
     Expects(index < count);
@@ -6,6 +6,7 @@
 //
 #include "wallet/create/wallet_create_import.h"
 
+#include "wallet/create/wallet_create_words.h"
 #include "wallet/wallet_phrases.h"
 #include "ui/text/text_utilities.h"
 #include "ui/widgets/buttons.h"
@@ -61,9 +62,7 @@ void Import::initControls(Fn<std::vector<QString>(QString)> wordsByPrefix) {
   const auto isValid = [=](int index) {
     Expects(index < count);
 
-    const auto word = (*inputs)[index]->word();
-    const auto words = wordsByPrefix(word);
-    return !words.empty() && (words.front() == word);
+    return IsValidWord((*inputs)[index]->word());
   };
 
   const auto showError = [=](int index) {
@@ -75,7 +75,6 @@ class Manager final {
 
   const std::unique_ptr<Ui::RpWidget> _content;
   const base::unique_qptr<Ui::FadeWrap<Ui::IconButton>> _backButton;
-  const base::flat_set<QString> _validWords;
   const Fn<std::vector<QString>(QString)> _wordsByPrefix;
 
   base::unique_qptr<Ui::RoundButton> _updateButton;
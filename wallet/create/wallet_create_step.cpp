@@ -357,7 +357,7 @@ void Step::ensureVisible(int top, int height) {
 }
 
 void Step::showLottie(const QString &name, QPoint position, int size) {
-  _lottie = std::make_unique<Ui::LottieAnimation>(inner(), Ui::LottieFromResource(name));
+  _lottie = std::make_unique<Ui::LottieAnimation>(inner(), name, size);
   _lottiePosition = position;
   _lottieSize = size;
 
@@ -0,0 +1,177 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/create/wallet_create_words.h"
+
+#include "ton/ton_wallet.h"
+
+namespace Wallet::Create {
+namespace {
+
+constexpr auto kFuzzyWordLengthMin = 3;
+
+}  // namespace
+
+WordsTrie::WordsTrie(std::vector<QString> words) : _words(std::move(words)) {
+  ranges::sort(_words);
+  _words.erase(ranges::unique(_words), end(_words));
+
+  _nodes.push_back(Node{.till = int(_words.size())});
+  build(0, 0, int(_words.size()), 0);
+}
+
+void WordsTrie::build(int index, int from, int till, int depth) {
+  // The word equal to the prefix of the node is sorted before the longer ones.
+  if (from != till && _words[from].size() == depth) {
+    _nodes[index].terminal = true;
+    ++from;
+  }
+
+  // Children of a node are stored next to each other, in the order of their labels.
+  const auto firstChild = int(_nodes.size());
+  for (auto i = from; i != till;) {
+    const auto label = _words[i][depth];
+    auto j = i + 1;
+    while (j != till && _words[j][depth] == label) {
+      ++j;
+    }
+    _nodes.push_back(Node{.from = i, .till = j, .label = label});
+    i = j;
+  }
+  const auto childrenTill = int(_nodes.size());
+  _nodes[index].firstChild = firstChild;
+  _nodes[index].childrenCount = childrenTill - firstChild;
+  for (auto i = firstChild; i != childrenTill; ++i) {
+    build(i, _nodes[i].from, _nodes[i].till, depth + 1);
+  }
+}
+
+bool WordsTrie::empty() const {
+  return _words.empty();
+}
+
+int WordsTrie::child(int node, QChar label) const {
+  const auto &parent = _nodes[node];
+  for (auto i = parent.firstChild, till = parent.firstChild + parent.childrenCount; i != till; ++i) {
+    if (_nodes[i].label == label) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int WordsTrie::find(const QString &prefix) const {
+  auto node = 0;
+  for (const auto ch : prefix) {
+    node = child(node, ch);
+    if (node < 0) {
+      break;
+    }
+  }
+  return node;
+}
+
+bool WordsTrie::contains(const QString &word) const {
+  const auto node = find(word);
+  return (node >= 0) && _nodes[node].terminal;
+}
+
+std::vector<QString> WordsTrie::byPrefix(const QString &prefix) const {
+  const auto node = find(prefix);
+  if (node < 0) {
+    return {};
+  }
+  return {begin(_words) + _nodes[node].from, begin(_words) + _nodes[node].till};
+}
+
+std::vector<QString> WordsTrie::byDistanceOne(const QString &word) const {
+  auto found = base::flat_set<int>();
+  if (!_nodes.empty()) {
+    collectFuzzy(0, word, 0, false, found);
+  }
+  auto result = std::vector<QString>();
+  result.reserve(found.size());
+  for (const auto index : found) {
+    result.push_back(_words[index]);
+  }
+  return result;
+}
+
+void WordsTrie::collectFuzzy(int node, const QString &word, int position, bool edited,
+                             base::flat_set<int> &result) const {
+  const auto &current = _nodes[node];
+  const auto children = [&](auto &&callback) {
+    for (auto i = current.firstChild, till = current.firstChild + current.childrenCount; i != till; ++i) {
+      callback(i);
+    }
+  };
+  if (position == word.size()) {
+    if (current.terminal && edited) {
+      result.emplace(current.from);
+    } else if (!edited) {
+      // The last letter is missing.
+      children([&](int index) {
+        if (_nodes[index].terminal) {
+          result.emplace(_nodes[index].from);
+        }
+      });
+    }
+    return;
+  }
+  const auto ch = word[position];
+  if (const auto next = child(node, ch); next >= 0) {
+    collectFuzzy(next, word, position + 1, edited, result);
+  }
+  if (edited) {
+    return;
+  }
+  // An extra letter, a missing one, a wrong one and two swapped ones.
+  collectFuzzy(node, word, position + 1, true, result);
+  children([&](int index) {
+    collectFuzzy(index, word, position, true, result);
+    if (_nodes[index].label != ch) {
+      collectFuzzy(index, word, position + 1, true, result);
+    }
+  });
+  if (position + 1 < word.size() && word[position + 1] != ch) {
+    if (const auto first = child(node, word[position + 1]); first >= 0) {
+      if (const auto second = child(first, ch); second >= 0) {
+        collectFuzzy(second, word, position + 2, true, result);
+      }
+    }
+  }
+}
+
+const WordsTrie &ValidWords() {
+  static const auto result = WordsTrie(Ton::Wallet::GetValidWords() | ranges::to_vector);
+  return result;
+}
+
+std::vector<QString> WordsByPrefix(const QString &word) {
+  const auto adjusted = word.trimmed().toLower();
+  const auto &validWords = ValidWords();
+  if (adjusted.isEmpty()) {
+    return {};
+  } else if (validWords.empty()) {
+    return {word};
+  }
+  auto result = validWords.byPrefix(adjusted);
+  if (result.empty() && adjusted.size() >= kFuzzyWordLengthMin) {
+    // Suggest the closest words for a typo, it still has to be fixed by choosing one.
+    result = validWords.byDistanceOne(adjusted);
+  }
+  return result;
+}
+
+bool IsValidWord(const QString &word) {
+  const auto &validWords = ValidWords();
+  if (word.trimmed().isEmpty()) {
+    return false;
+  }
+  return validWords.empty() || validWords.contains(word);
+}
+
+}  // namespace Wallet::Create
@@ -0,0 +1,49 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+namespace Wallet::Create {
+
+// Prefix tree over the sorted mnemonic words. Every node covers a contiguous
+// range of the words, so a prefix lookup is a walk down the tree.
+class WordsTrie final {
+ public:
+  explicit WordsTrie(std::vector<QString> words);
+
+  [[nodiscard]] bool empty() const;
+  [[nodiscard]] bool contains(const QString &word) const;
+  [[nodiscard]] std::vector<QString> byPrefix(const QString &prefix) const;
+
+  // Words a single insertion, deletion, substitution or transposition away.
+  [[nodiscard]] std::vector<QString> byDistanceOne(const QString &word) const;
+
+ private:
+  struct Node {
+    int from = 0;
+    int till = 0;
+    int firstChild = 0;
+    int childrenCount = 0;
+    QChar label;
+    bool terminal = false;
+  };
+
+  void build(int index, int from, int till, int depth);
+  [[nodiscard]] int find(const QString &prefix) const;
+  [[nodiscard]] int child(int node, QChar label) const;
+  void collectFuzzy(int node, const QString &word, int position, bool edited, base::flat_set<int> &result) const;
+
+  std::vector<QString> _words;
+  std::vector<Node> _nodes;
+};
+
+[[nodiscard]] const WordsTrie &ValidWords();
+
+// Suggestions for a typed word, the closest words when nothing starts with it.
+[[nodiscard]] std::vector<QString> WordsByPrefix(const QString &word);
+[[nodiscard]] bool IsValidWord(const QString &word);
+
+}  // namespace Wallet::Create
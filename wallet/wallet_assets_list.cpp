@@ -46,36 +46,65 @@ auto addressPartWidth(const QString &address, int from, int length = -1) {
   return addressStyle().font->width(address.mid(from, length));
 }
 
-[[nodiscard]] AssetItemLayout prepareLayout(const AssetItem &data) {
-  const auto [type, title, token, address, balance, outdated] = v::match(
+[[nodiscard]] QImage prepareIcon(const AssetItem &data) {
+  const auto token = v::match(
+      data, [](const TokenItem &item) { return item.token; }, [](auto &&) { return Ton::Symbol::ton(); });
+  return Ui::TokenIcon(token, st::walletTokensListRowIconSize);
+}
+
+// Identity of the asset, which stays the same while its values change.
+using AssetKey = std::pair<size_t, QString>;
+
+[[nodiscard]] AssetKey assetKey(const AssetItem &data) {
+  return {data.index(),
+          v::match(
+              data, [](const TokenItem &item) { return item.token.rootContractAddress(); },
+              [](const DePoolItem &item) { return item.address; },
+              [](const MultisigItem &item) { return item.address; })};
+}
+
+[[nodiscard]] auto assetValues(const AssetItem &data) {
+  return v::match(
       data,
       [](const TokenItem &item) {
         const auto layoutType = item.token.isToken() ? LayoutType::Compact : LayoutType::Full;
 
         return std::make_tuple(layoutType, item.token.name(), item.token,
-                               item.token.isTon() ? Ton::Wallet::ConvertIntoRaw(item.address) : QString{}, item.balance,
+                               item.token.isTon() ? RawAddress(item.address) : QString{}, item.balance,
                                item.outdated);
       },
       [](const DePoolItem &item) {
         return std::make_tuple(LayoutType::Full, QString{"DePool"}, Ton::Symbol::ton(),
-                               Ton::Wallet::ConvertIntoRaw(item.address), int128{item.total}, false);
+                               RawAddress(item.address), int128{item.total}, false);
       },
       [](const MultisigItem &item) {
         return std::make_tuple(LayoutType::Full, QString{"Msig"}, Ton::Symbol::ton(),
-                               Ton::Wallet::ConvertIntoRaw(item.address), int128{item.balance}, false);
+                               RawAddress(item.address), int128{item.balance}, false);
       });
+}
 
+void prepareBalance(AssetItemLayout &layout, const int128 &balance, const Ton::Symbol &token) {
   const auto formattedBalance = FormatAmount(balance > 0 ? balance : 0, token);
 
+  layout.balanceGrams.setText(st::walletTokensListRowGramsStyle, formattedBalance.gramsString);
+
+  layout.balanceNano.setText(st::walletTokensListRowNanoStyle,
+                             formattedBalance.separator + formattedBalance.nanoString);
+}
+
+void prepareOutdated(AssetItemLayout &layout, bool outdated) {
+  layout.outdated = outdated ? Ui::Text::String(st::walletTokensListOutdatedStyle, "old") : Ui::Text::String();
+}
+
+[[nodiscard]] AssetItemLayout prepareLayout(const AssetItem &data) {
+  const auto [type, title, token, address, balance, outdated] = assetValues(data);
+
   auto result = AssetItemLayout();
   result.type = type;
-  result.image = Ui::InlineTokenIcon(token, st::walletTokensListRowIconSize);
+  result.image = prepareIcon(data);
   result.title.setText(st::walletTokensListRowTitleStyle.style, title);
 
-  result.balanceGrams.setText(st::walletTokensListRowGramsStyle, formattedBalance.gramsString);
-
-  result.balanceNano.setText(st::walletTokensListRowNanoStyle,
-                             formattedBalance.separator + formattedBalance.nanoString);
+  prepareBalance(result, balance, token);
 
   if (!address.isEmpty()) {
     result.address = Ui::Text::String(addressStyle(), address, _defaultOptions, st::walletAddressWidthMin);
@@ -83,9 +112,7 @@ auto addressPartWidth(const QString &address, int from, int length = -1) {
                                                                        addressPartWidth(address, address.size() / 2));
   }
 
-  if (outdated) {
-    result.outdated = Ui::Text::String(st::walletTokensListOutdatedStyle, "old");
-  }
+  prepareOutdated(result, outdated);
 
   return result;
 }
@@ -143,7 +170,7 @@ class AssetsListRow final {
     if (_layout.type == LayoutType::Compact) {
       // draw asset name
       p.setPen(st::walletTokensListRowTitleStyle.textFg);
-      const auto titleTop = iconTop + _layout.image.height() - _layout.title.minHeight();
+      const auto titleTop = iconTop + st::walletTokensListRowIconSize - _layout.title.minHeight();
       _layout.title.drawRight(p, 0, titleTop, _layout.title.maxWidth(), availableWidth);
     }
 
@@ -174,14 +201,36 @@ class AssetsListRow final {
     }
   }
 
+  // Returns whether anything visible has changed.
   bool refresh(const AssetItem &item) {
     if (_data == item) {
       return false;
     }
 
-    _layout = prepareLayout(item);
+    const auto [type, title, token, address, balance, outdated] = assetValues(item);
+    const auto [wasType, wasTitle, wasToken, wasAddress, wasBalance, wasOutdated] = assetValues(_data);
+    auto changed = false;
+    if (std::tie(type, title, token, address) != std::tie(wasType, wasTitle, wasToken, wasAddress)) {
+      _layout = prepareLayout(item);
+      _height = assetRowHeight(layoutType());
+      changed = true;
+    } else {
+      // Only balances and flags change on refreshes, the rest is kept.
+      if (balance != wasBalance) {
+        prepareBalance(_layout, balance, token);
+        changed = true;
+      }
+      if (outdated != wasOutdated) {
+        prepareOutdated(_layout, outdated);
+        changed = true;
+      }
+    }
     _data = item;
-    return true;
+    return changed;
+  }
+
+  void refreshIcon() {
+    _layout.image = prepareIcon(_data);
   }
 
   void resizeToWidth(int width) {
@@ -285,6 +334,7 @@ void AssetsList::setupContent(rpl::producer<AssetsListState> &&state) {
                 }
                 case Ui::VerticalLayoutReorder::State::Applied: {
                   base::reorder(_buttons, event.oldPosition, event.newPosition);
+                  base::reorder(_rows, event.oldPosition, event.newPosition);
                   for (int i = 0; i < _buttons.size(); ++i) {
                     *_buttons[i].index = i;
                   }
@@ -330,9 +380,8 @@ void AssetsList::setupContent(rpl::producer<AssetsListState> &&state) {
   std::forward<std::decay_t<decltype(state)>>(state) |
       rpl::start_with_next(
           [=](AssetsListState &&state) {
-            refreshItemValues(state);
-            if (!mergeListChanged(std::move(state))) {
-              return _widget.update();
+            if (!mergeList(std::move(state))) {
+              return;
             }
 
             int totalHeight = 0;
@@ -448,28 +497,57 @@ void AssetsList::setupContent(rpl::producer<AssetsListState> &&state) {
             _widget.update();
           },
           lifetime());
-}
 
-void AssetsList::refreshItemValues(const AssetsListState &data) {
-  for (size_t i = 0; i < _rows.size() && i < data.items.size(); ++i) {
-    _rows[i]->refresh(data.items[i]);
-  }
+  Ui::TokenIconsUpdated()  //
+      | rpl::start_with_next(
+            [=] {
+              for (const auto &row : _rows) {
+                row->refreshIcon();
+              }
+              _widget.update();
+            },
+            lifetime());
 }
 
-bool AssetsList::mergeListChanged(AssetsListState &&data) {
-  if (_rows.size() == data.items.size()) {
-    return false;
+bool AssetsList::mergeList(AssetsListState &&data) {
+  auto previous = std::vector<const AssetsListRow *>();
+  auto existing = base::flat_map<AssetKey, std::unique_ptr<AssetsListRow>>();
+  previous.reserve(_rows.size());
+  for (auto &row : _rows) {
+    previous.push_back(row.get());
+    existing.emplace(assetKey(row->data()), std::move(row));
   }
 
-  while (_rows.size() > data.items.size()) {
-    _rows.pop_back();
+  // Rows are matched by identity, so inserts, removals and reorders only
+  // move them between the buttons, which stay in place.
+  auto rows = std::vector<std::unique_ptr<AssetsListRow>>();
+  rows.reserve(data.items.size());
+  auto dirty = std::vector<bool>();
+  dirty.reserve(data.items.size());
+  for (auto &item : data.items) {
+    const auto i = existing.find(assetKey(item));
+    if (i == end(existing) || !i->second) {
+      rows.push_back(std::make_unique<AssetsListRow>(item));
+      dirty.push_back(true);
+    } else {
+      const auto changed = i->second->refresh(item);
+      rows.push_back(std::move(i->second));
+      const auto position = rows.size() - 1;
+      dirty.push_back(changed || position >= previous.size() || previous[position] != rows.back().get());
+    }
   }
-
-  for (size_t i = _rows.size(); i < data.items.size(); ++i) {
-    _rows.emplace_back(std::make_unique<AssetsListRow>(data.items[i]));
+  _rows = std::move(rows);
+
+  auto layoutChanged = (_buttons.size() != _rows.size());
+  for (size_t i = 0; i < _buttons.size() && i < _rows.size(); ++i) {
+    const auto button = _buttons[i].button;
+    if (button->height() != assetRowHeight(_rows[i]->layoutType())) {
+      layoutChanged = true;
+    } else if (dirty[i]) {
+      button->update();
+    }
   }
-
-  return true;
+  return layoutChanged;
 }
 
 rpl::producer<AssetsListState> MakeTokensListState(rpl::producer<Ton::WalletViewerState> state) {
@@ -543,7 +621,8 @@ bool operator==(const AssetItem &a, const AssetItem &b) {
       a,
       [&](const TokenItem &left) {
         const auto &right = v::get<TokenItem>(b);
-        return left.address == right.address && left.balance == right.balance && left.token == right.token;
+        return left.address == right.address && left.balance == right.balance && left.token == right.token &&
+               left.outdated == right.outdated;
       },
       [&](const DePoolItem &left) {
         const auto &right = v::get<DePoolItem>(b);
@@ -24,7 +24,7 @@ struct TokenItem {
   Ton::Symbol token = Ton::Symbol::ton();
   QString address = "";
   int128 balance = 0;
-  bool outdated;
+  bool outdated = false;
 };
 
 struct DePoolItem {
@@ -68,8 +68,8 @@ class AssetsList final {
  private:
   void setupContent(rpl::producer<AssetsListState> &&state);
 
-  void refreshItemValues(const AssetsListState &data);
-  bool mergeListChanged(AssetsListState &&data);
+  // Returns whether the rows need to be laid out again.
+  bool mergeList(AssetsListState &&data);
 
   Ui::RpWidget _widget;
   not_null<Ui::ScrollArea *> _scroll;
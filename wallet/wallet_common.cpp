@@ -9,6 +9,7 @@
 #include "wallet/wallet_send_grams.h"
 #include "ton/ton_state.h"
 #include "ton/ton_result.h"
+#include "ton/ton_wallet.h"
 #include "ui/layers/generic_box.h"
 #include "ui/widgets/input_fields.h"
 #include "base/qthelp_url.h"
@@ -16,7 +17,10 @@
 
 #include <QtCore/QLocale>
 
+#include <mutex>
+
 constexpr auto kMaxAmountInt = 9;
+constexpr auto kRawAddressCacheMax = 4096;
 
 namespace Wallet {
 namespace {
@@ -25,48 +29,6 @@ constexpr auto ipow(int64_t base, size_t power, int64_t result = 1) -> int64_t {
   return power < 1 ? result : ipow(base * base, power >> 1u, (power & 0x1u) ? (result * base) : result);
 }
 
-constexpr auto ipow(const int128 &base, size_t power, const int128 &result = 1) -> int128 {
-  return power < 1 ? result : ipow(base * base, power >> 1u, (power & 0x1u) ? (result * base) : result);
-}
-
-std::optional<int128> ParseAmountInt(const QString &trimmed, size_t decimals) {
-  const auto one = ipow(int128{10}, decimals);
-  try {
-    const int128 amount{trimmed.toStdString()};
-    return ((amount <= std::numeric_limits<int128>::max() / one) &&
-            (amount >= std::numeric_limits<int128>::min() / one))
-               ? std::make_optional(amount * one)
-               : std::nullopt;
-  } catch (std::runtime_error &) {
-    return std::nullopt;
-  }
-}
-
-std::optional<int128> ParseAmountFraction(QString trimmed, size_t decimals) {
-  while (trimmed.size() < decimals) {
-    trimmed.append('0');
-  }
-  auto zeros = 0;
-  for (const auto &ch : trimmed) {
-    if (ch == '0') {
-      ++zeros;
-    } else {
-      break;
-    }
-  }
-  if (zeros == trimmed.size()) {
-    return 0;
-  } else if (trimmed.size() > decimals) {
-    return std::nullopt;
-  }
-  try {
-    const int128 value{trimmed.mid(zeros).toStdString()};
-    return (value > 0 && value < ipow(int128{10}, decimals)) ? std::make_optional(value) : std::nullopt;
-  } catch (std::runtime_error &) {
-    return std::nullopt;
-  }
-}
-
 [[nodiscard]] FixedAmount FixAmountInput(const QString &was, const QString &text, int position, size_t decimals) {
   const auto separator = AmountSeparator();
 
@@ -113,91 +75,250 @@ std::optional<int128> ParseAmountFraction(QString trimmed, size_t decimals) {
   return result;
 }
 
-QString SeparateDecimals(int128 num, const QLocale &locale) {
-  QString result = "";
-  int cnt = 0;
+#ifdef __SIZEOF_INT128__
+using Magnitude = unsigned __int128;
+
+[[nodiscard]] Magnitude ToMagnitude(const int128 &amount) {
+  const auto value = boost::multiprecision::abs(amount);
+  const auto mask = int128(std::numeric_limits<uint64>::max());
+  return (Magnitude(static_cast<uint64>(value >> 64)) << 64) | Magnitude(static_cast<uint64>(value & mask));
+}
+
+[[nodiscard]] int128 FromMagnitude(Magnitude value, bool negative) {
+  const auto result = (int128(static_cast<uint64>(value >> 64)) << 64) | int128(static_cast<uint64>(value));
+  return negative ? int128(-result) : result;
+}
+#else  // __SIZEOF_INT128__
+using Magnitude = boost::multiprecision::uint128_t;
+
+[[nodiscard]] Magnitude ToMagnitude(const int128 &amount) {
+  return Magnitude(boost::multiprecision::abs(amount));
+}
+
+[[nodiscard]] int128 FromMagnitude(const Magnitude &value, bool negative) {
+  const auto result = int128(value);
+  return negative ? int128(-result) : result;
+}
+#endif  // __SIZEOF_INT128__
+
+// Enough for the 39 digits of the largest magnitude.
+constexpr auto kMaxDigits = 40;
 
-  if (num == 0) {
-    return "0";
+constexpr char kDigitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+struct AmountSeparators {
+  QChar group;
+  QChar positive;
+  QChar negative;
+};
+
+[[nodiscard]] AmountSeparators ComputeSeparators(const QLocale &locale) {
+  return AmountSeparators{
+      .group = locale.groupSeparator(),
+      .positive = locale.positiveSign(),
+      .negative = locale.negativeSign(),
+  };
+}
+
+[[nodiscard]] const AmountSeparators &LocaleSeparators(bool simple) {
+  static const auto system = ComputeSeparators(QLocale::system());
+  static const auto c = ComputeSeparators(QLocale::c());
+  return simple ? c : system;
+}
+
+[[nodiscard]] QChar DecimalPoint() {
+  static const auto result = QLocale::system().decimalPoint();
+  return result;
+}
+
+[[nodiscard]] Magnitude Power10(uint32_t power) {
+  auto result = Magnitude(1);
+  while (power--) {
+    result *= 10;
   }
+  return result;
+}
 
-  num = boost::multiprecision::abs(num);
-  while (num > 0) {
-    result.insert(0, QString::number(static_cast<int>(num % 10)));
-    num = num / 10;
-    if (num > 0 && ++cnt == 3) {
-      result.insert(0, locale.groupSeparator());
-      cnt = 0;
-    }
+// Writes the digits right to left ending at the given position, padded with zeros to the minimal count.
+[[nodiscard]] int WriteDigits(char *end, Magnitude value, int minimal = 1) {
+  auto written = 0;
+  while (value >= 100) {
+    const auto pair = static_cast<int>(value % 100) * 2;
+    value /= 100;
+    *--end = kDigitPairs[pair + 1];
+    *--end = kDigitPairs[pair];
+    written += 2;
+  }
+  if (value >= 10) {
+    const auto pair = static_cast<int>(value) * 2;
+    *--end = kDigitPairs[pair + 1];
+    *--end = kDigitPairs[pair];
+    written += 2;
+  } else if (value > 0 || !written) {
+    *--end = char('0' + static_cast<int>(value));
+    ++written;
   }
+  while (written < minimal) {
+    *--end = '0';
+    ++written;
+  }
+  return written;
+}
 
-  return result;
-};
+[[nodiscard]] bool IsDigit(QChar ch) {
+  return (ch >= '0' && ch <= '9');
+}
 
-QString FillZeros(int128 num, int width, QChar sym) {
-  QString result = "";
+// Integer part with an optional minus, multiplied by 10^decimals. Empty digits are zero.
+[[nodiscard]] std::optional<int128> ParseAmountInt(const QChar *from, const QChar *till, uint32_t decimals) {
+  const auto negative = (from != till && *from == '-');
+  if (negative) {
+    ++from;
+  }
+  const auto one = Power10(decimals);
+  const auto limit = std::numeric_limits<Magnitude>::max() / one;
+  auto value = Magnitude(0);
+  for (; from != till; ++from) {
+    if (!IsDigit(*from)) {
+      return std::nullopt;
+    }
+    const auto digit = from->unicode() - '0';
+    if (value > (limit - digit) / 10) {
+      return std::nullopt;
+    }
+    value = value * 10 + digit;
+  }
+  return FromMagnitude(value * one, negative);
+}
 
-  while (num > 0) {
-    result.insert(0, QString::number(static_cast<int>(num % 10)));
-    num = num / 10;
+// Fraction part, right-padded with zeros to the given decimals.
+[[nodiscard]] std::optional<int128> ParseAmountFraction(const QChar *from, const QChar *till, uint32_t decimals) {
+  const auto significant = std::find_if(from, till, [](QChar ch) { return ch != '0'; });
+  if (significant == till) {
+    return int128(0);
+  } else if (till - from > int(decimals)) {
+    return std::nullopt;
   }
+  const auto length = uint32_t(till - from);
+  auto value = Magnitude(0);
+  for (; from != till; ++from) {
+    if (!IsDigit(*from)) {
+      return std::nullopt;
+    }
+    value = value * 10 + (from->unicode() - '0');
+  }
+  return FromMagnitude(value * Power10(decimals - length), false);
+}
+
+[[nodiscard]] bool IsHexDigit(QChar ch) {
+  return IsDigit(ch) || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
+}
+
+[[nodiscard]] bool IsEncodedAddressChar(QChar ch) {
+  return IsDigit(ch) || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_' || ch == '-';
+}
 
-  while (result.size() < width) {
-    result.insert(0, sym);
+template <typename Predicate>
+void AppendFiltered(QString &to, const QChar *from, const QChar *till, int limit, Predicate accept) {
+  for (; from != till && limit > 0; ++from) {
+    if (accept(*from)) {
+      to.append(*from);
+      --limit;
+    }
   }
+}
 
-  return result;
+// Detects the kind of the address by its first characters and drops everything
+// not allowed in that kind, so that pasted text is cleaned up the same way as links.
+[[nodiscard]] ParsedAddress ScanAddress(const QChar *from, const QChar *till) {
+  const auto colon = std::find(from, till, QChar(':'));
+  if (colon != till && colon != from) {
+    const auto hasMinus = (*from == '-');
+    auto result = QString();
+    result.reserve(int(hasMinus) + 3 + kRawAddressLength);
+    if (hasMinus) {
+      result.append('-');
+    }
+    AppendFiltered(result, from + int(hasMinus), colon, 2, IsDigit);
+    result.append(':');
+    AppendFiltered(result, colon + 1, till, kRawAddressLength, IsHexDigit);
+    return ParsedAddressTon{.address = std::move(result), .packed = false};
+  } else if (till - from >= 2 && from[0] == '0' && from[1] == 'x') {
+    auto result = QString();
+    result.reserve(2 + kEtheriumAddressLength);
+    result.append(qstr("0x"));
+    AppendFiltered(result, from + 2, till, kEtheriumAddressLength, IsHexDigit);
+    return ParsedAddressEth{.address = std::move(result)};
+  }
+  auto result = QString();
+  result.reserve(kEncodedAddressLength);
+  AppendFiltered(result, from, till, kEncodedAddressLength, IsEncodedAddressChar);
+  return ParsedAddressTon{.address = std::move(result), .packed = true};
 }
 
 }  // namespace
 
 FormattedAmount FormatAmount(const int128 &amount, const Ton::Symbol &symbol, FormatFlags flags) {
   const auto decimals = static_cast<uint32_t>(symbol.decimals());
-  const auto one = ipow(int128{10}, decimals);
+  const auto one = Power10(decimals);
+  const auto magnitude = ToMagnitude(amount);
+  const auto amountInt = magnitude / one;
+  const auto amountFraction = magnitude % one;
 
   auto result = FormattedAmount();
   result.token = symbol;
-  const auto amountInt = amount / one;
-  const auto amountFraction = boost::multiprecision::abs(amount) % one;
-  auto roundedFraction = amountFraction;
-  if (flags & FormatFlag::Rounded) {
-    if (boost::multiprecision::abs(amountInt) >= 1'000'000 && (roundedFraction % 1'000'000)) {
-      roundedFraction -= (roundedFraction % 1'000'000);
-    } else if (boost::multiprecision::abs(amountInt) >= 1'000 && (roundedFraction % 1'000)) {
-      roundedFraction -= (roundedFraction % 1'000);
-    }
-  }
-  const auto precise = (roundedFraction == amountFraction);
+  const auto precise = !(flags & FormatFlag::Rounded) ||
+                       !((amountInt >= 1'000'000 && (amountFraction % 1'000'000) != 0) ||
+                         (amountInt >= 1'000 && (amountFraction % 1'000) != 0));
   auto fraction = amountFraction;
   auto zeros = 0u;
   while (zeros < decimals && fraction % 10u == 0) {
     fraction /= 10u;
     ++zeros;
   }
-  const auto system = QLocale::system();
-  const auto locale = (flags & FormatFlag::Simple) ? QLocale::c() : system;
-  const auto separator = system.decimalPoint();
-
-  result.gramsString = SeparateDecimals(amountInt, locale);
-  if ((flags & FormatFlag::Signed) && amount > 0) {
-    result.gramsString = locale.positiveSign() + result.gramsString;
-  } else if (amount < 0) {
-    result.gramsString = locale.negativeSign() + result.gramsString;
+  const auto &separators = LocaleSeparators(bool(flags & FormatFlag::Simple));
+
+  char digits[kMaxDigits];
+  const auto count = WriteDigits(digits + kMaxDigits, amountInt);
+  const auto sign = ((flags & FormatFlag::Signed) && amount > 0) ? separators.positive
+                    : (amount < 0)                                ? separators.negative
+                                                                  : QChar();
+  const auto hasSign = !sign.isNull();
+  result.gramsString = QString(int(hasSign) + count + (count - 1) / 3, Qt::Uninitialized);
+  auto out = result.gramsString.data();
+  if (hasSign) {
+    *out++ = sign;
   }
-  result.full = result.gramsString;
-  if (zeros < decimals) {
-    result.separator = separator;
-    result.nanoString = FillZeros(fraction, decimals - zeros, QChar('0'));
-    if (!precise) {
-      const auto fractionLength =                               //
-          (boost::multiprecision::abs(amountInt) >= 1'000'000)  //
-              ? 3
-              : (boost::multiprecision::abs(amountInt) >= 1'000)  //
-                    ? 6
-                    : decimals;
-      result.nanoString = result.nanoString.mid(0, fractionLength);
+  for (auto i = 0; i != count; ++i) {
+    if (i > 0 && (count - i) % 3 == 0) {
+      *out++ = separators.group;
     }
-    result.full += separator + result.nanoString;
+    *out++ = QChar::fromLatin1(digits[kMaxDigits - count + i]);
+  }
+
+  if (zeros < decimals) {
+    const auto length = WriteDigits(digits + kMaxDigits, fraction, int(decimals - zeros));
+    const auto fractionLength = precise                     ? length
+                                : (amountInt >= 1'000'000) ? 3
+                                : (amountInt >= 1'000)     ? 6
+                                                           : int(decimals);
+    result.separator = DecimalPoint();
+    result.nanoString = QString::fromLatin1(digits + kMaxDigits - length, std::min(length, fractionLength));
+
+    result.full.reserve(result.gramsString.size() + 1 + result.nanoString.size());
+    result.full.append(result.gramsString).append(result.separator).append(result.nanoString);
+  } else {
+    result.full = result.gramsString;
   }
   return result;
 }
@@ -208,54 +329,44 @@ FormattedAmount FormatAmount(const int128 &amount, const Ton::Symbol &symbol, Fo
 }
 
 std::optional<int128> ParseAmountString(const QString &amount, size_t decimals) {
-  const auto trimmed = amount.trimmed();
-  const auto separator = QString(QLocale::system().decimalPoint());
-  const auto index1 = trimmed.indexOf('.');
-  const auto index2 = trimmed.indexOf(',');
-  const auto index3 = (separator == "." || separator == ",") ? -1 : trimmed.indexOf(separator);
-  const auto found = (index1 >= 0 ? 1 : 0) + (index2 >= 0 ? 1 : 0) + (index3 >= 0 ? 1 : 0);
-  if (found > 1) {
-    return std::nullopt;
+  auto from = amount.constData();
+  auto till = from + amount.size();
+  while (from != till && from->isSpace()) {
+    ++from;
   }
-  const auto index = (index1 >= 0) ? index1 : (index2 >= 0) ? index2 : index3;
-  const auto used = (index1 >= 0) ? "." : (index2 >= 0) ? "," : separator;
-  auto amountInt = ParseAmountInt(trimmed.mid(0, index), decimals);
-  auto amountFraction = ParseAmountFraction(trimmed.mid(index + used.size()), decimals);
-  if (index < 0 || index == trimmed.size() - used.size()) {
-    return amountInt;
-  } else if (index == 0) {
-    return amountFraction;
-  } else if (!amountFraction || !amountInt) {
+  while (till != from && (till - 1)->isSpace()) {
+    --till;
+  }
+
+  // Only one kind of the separator is allowed, the first one splits the amount.
+  const auto system = DecimalPoint();
+  auto separator = till;
+  for (auto i = from; i != till; ++i) {
+    if (*i != '.' && *i != ',' && *i != system) {
+      continue;
+    } else if (separator == till) {
+      separator = i;
+    } else if (*i != *separator) {
+      return std::nullopt;
+    }
+  }
+
+  const auto integerDecimals = static_cast<uint32_t>(decimals);
+  if (separator == till || separator == till - 1) {
+    return ParseAmountInt(from, separator, integerDecimals);
+  } else if (separator == from) {
+    return ParseAmountFraction(separator + 1, till, integerDecimals);
+  }
+  const auto amountInt = ParseAmountInt(from, separator, integerDecimals);
+  const auto amountFraction = ParseAmountFraction(separator + 1, till, integerDecimals);
+  if (!amountFraction || !amountInt) {
     return std::nullopt;
   }
   return *amountInt + (*amountInt < 0 ? (-*amountFraction) : (*amountFraction));
 }
 
 ParsedAddress ParseAddress(const QString &address) {
-  const auto colonPosition = address.indexOf(':');
-  const auto hexPrefixPosition = address.indexOf("0x");
-  if (colonPosition > 0) {
-    const auto hasMinus = address[0] == '-';
-
-    return ParsedAddressTon{
-        .address = (hasMinus ? QString{"-"} : QString{}) +
-                   address.mid(hasMinus, colonPosition).replace(QRegularExpression("[^\\d]"), QString()).mid(0, 2) +
-                   ":" +
-                   address.mid(colonPosition, -1)
-                       .replace(QRegularExpression("[^a-fA-F0-9]"), QString())
-                       .mid(0, kRawAddressLength),
-        .packed = false};
-  } else if (hexPrefixPosition == 0) {
-    return ParsedAddressEth{
-        .address =
-            QString{"0x"} +
-            address.mid(2, -1).replace(QRegularExpression("[^a-fA-F0-9]"), QString()).mid(0, kEtheriumAddressLength)};
-  } else {
-    return ParsedAddressTon{
-        .address =
-            address.mid(0, -1).replace(QRegularExpression("[^a-zA-Z0-9_\\-]"), QString()).mid(0, kEncodedAddressLength),
-        .packed = true};
-  }
+  return ScanAddress(address.constData(), address.constData() + address.size());
 }
 
 PreparedInvoice ParseInvoice(QString invoice) {
@@ -264,54 +375,42 @@ PreparedInvoice ParseInvoice(QString invoice) {
   const auto transferPrefix = qstr("transfer/");
   const auto stakePrefix = qstr("stake/");
 
+  auto addressPosition = 0;
   if (const auto transferPrefixPosition = invoice.indexOf(transferPrefix, 0, Qt::CaseInsensitive);
       transferPrefixPosition >= 0) {
-    invoice = invoice.mid(transferPrefixPosition + transferPrefix.size());
+    addressPosition = transferPrefixPosition + transferPrefix.size();
     invoiceKind = InvoiceKind::Transfer;
   } else if (const auto stakePrefixPosition = invoice.indexOf(stakePrefix, 0, Qt::CaseInsensitive);
              stakePrefixPosition >= 0) {
-    invoice = invoice.mid(stakePrefixPosition + stakePrefix.size());
+    addressPosition = stakePrefixPosition + stakePrefix.size();
     invoiceKind = InvoiceKind::Stake;
   } else {
     invoiceKind = InvoiceKind::Transfer;
   }
 
-  QString address{};
   int64 amount{};
   auto token = Ton::Symbol::ton();
   QString comment{};
 
-  const auto paramsPosition = invoice.indexOf('?');
+  const auto paramsPosition = invoice.indexOf('?', addressPosition);
   if (paramsPosition >= 0) {
     const auto params =
         qthelp::url_parse_params(invoice.mid(paramsPosition + 1), qthelp::UrlParamNameTransform::ToLower);
     amount = params.value("amount").toULongLong();
+    comment = params.value("text");
 
     // TODO: string to token, maybe use root token contract address
 
     //token = Ton::tokenFromString(params.value("token"));
-    comment = params.value("text");
   }
 
-  const auto colonPosition = invoice.indexOf(':');
-  const auto hexPrefixPosition = invoice.indexOf("0x");
-  if (colonPosition > 0) {
-    const auto hasMinus = invoice[0] == '-';
-
-    address = (hasMinus ? QString{"-"} : QString{}) +
-              invoice.mid(hasMinus, colonPosition).replace(QRegularExpression("[^\\d]"), QString()).mid(0, 2) + ":" +
-              invoice.mid(colonPosition, std::max(paramsPosition - colonPosition, -1))
-                  .replace(QRegularExpression("[^a-fA-F0-9]"), QString())
-                  .mid(0, kRawAddressLength);
-  } else if (hexPrefixPosition == 0) {
-    address = QString{"0x"} + invoice.mid(2, std::max(paramsPosition - hexPrefixPosition, -1))
-                                  .replace(QRegularExpression("[^a-fA-F0-9]"), QString())
-                                  .mid(0, kEtheriumAddressLength);
-  } else {
-    address = invoice.mid(0, paramsPosition)
-                  .replace(QRegularExpression("[^a-zA-Z0-9_\\-]"), QString())
-                  .mid(0, kEncodedAddressLength);
-  }
+  // Unlike the regular expressions this replaced, only the address part is looked at,
+  // a colon in the parameters no longer makes it raw and an Ethereum address
+  // no longer takes the characters after the '?'.
+  const auto data = invoice.constData();
+  const auto address = v::match(
+      ScanAddress(data + addressPosition, data + (paramsPosition >= 0 ? paramsPosition : invoice.size())),
+      [](auto &&parsed) { return std::move(parsed.address); });
 
   switch (invoiceKind) {
     case InvoiceKind::Transfer:
@@ -331,6 +430,39 @@ PreparedInvoice ParseInvoice(QString invoice) {
   }
 }
 
+bool IsTransferLink(const QString &link) {
+  auto from = 0;
+  auto till = int(link.size());
+  while (from != till && link[from].isSpace()) {
+    ++from;
+  }
+  while (till != from && link[till - 1].isSpace()) {
+    --till;
+  }
+  const auto skip = [&](const QString &prefix) {
+    if (!link.midRef(from, till - from).startsWith(prefix, Qt::CaseInsensitive)) {
+      return false;
+    }
+    from += prefix.size();
+    return true;
+  };
+
+  // [freeton://](transfer|stake)/ prefix, then an encoded address optionally followed by a slash.
+  const auto scheme = skip(qstr("freeton://"));
+  if (!skip(qstr("transfer/")) && !skip(qstr("stake/")) && scheme) {
+    return false;
+  }
+  for (auto i = 0; i != kEncodedAddressLength; ++i, ++from) {
+    if (from == till || !IsEncodedAddressChar(link[from])) {
+      return false;
+    }
+  }
+  if (from != till && link[from] == '/') {
+    ++from;
+  }
+  return (from == till) || (link[from] == '?');
+}
+
 int64 CalculateValue(const Ton::Transaction &data) {
   const auto outgoing = ranges::accumulate(data.outgoing, int64(0), ranges::plus(), &Ton::Message::value);
   return data.incoming.value - outgoing;
@@ -351,6 +483,31 @@ QString ExtractAddress(const Ton::Transaction &data) {
   }
 }
 
+QString RawAddress(const QString &address) {
+  static auto mutex = std::mutex();
+  static auto cache = QHash<QString, QString>();
+  if (address.isEmpty()) {
+    return address;
+  }
+  {
+    const auto lock = std::unique_lock(mutex);
+    const auto i = cache.constFind(address);
+    if (i != cache.cend()) {
+      return *i;
+    }
+  }
+  const auto raw = Ton::Wallet::ConvertIntoRaw(address);
+
+  const auto lock = std::unique_lock(mutex);
+  if (cache.size() >= kRawAddressCacheMax) {
+    cache.clear();
+  }
+  // The raw form maps to itself, so converting it again is free too.
+  const auto i = cache.insert(raw, raw);
+  cache.insert(address, *i);
+  return *i;
+}
+
 bool IsEncryptedMessage(const Ton::Transaction &data) {
   const auto &message = data.outgoing.empty() ? data.incoming.message : data.outgoing.front().message;
   return !message.data.isEmpty() && message.type == Ton::MessageDataType::EncryptedText;
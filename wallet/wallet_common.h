@@ -36,6 +36,10 @@ inline constexpr auto kExplorerPath = "https://ton-explorer.com/transactions/";
 
 using int128 = Ton::int128;
 
+// Received transactions never change, a decrypted one replaces the handle,
+// so the history rows, the view requests and the boxes share a single copy.
+using TransactionPtr = std::shared_ptr<const Ton::Transaction>;
+
 struct SelectedToken {
   Ton::Symbol symbol;
 
@@ -221,6 +225,7 @@ using PreparedInvoice = std::variant<  //
 enum class Action {
   Refresh,
   Export,
+  ExportHistory,
   Send,
   Receive,
   ChangePassword,
@@ -264,8 +269,11 @@ using ParsedAddress = std::variant<ParsedAddressTon, ParsedAddressEth>;
 [[nodiscard]] std::optional<int128> ParseAmountString(const QString &amount, size_t decimals);
 [[nodiscard]] ParsedAddress ParseAddress(const QString &address);
 [[nodiscard]] PreparedInvoice ParseInvoice(QString invoice);
+[[nodiscard]] bool IsTransferLink(const QString &link);
 [[nodiscard]] int64 CalculateValue(const Ton::Transaction &data);
 [[nodiscard]] QString ExtractAddress(const Ton::Transaction &data);
+// Ton::Wallet::ConvertIntoRaw() interned for the repeated counterparties, safe to call from any thread.
+[[nodiscard]] QString RawAddress(const QString &address);
 [[nodiscard]] bool IsEncryptedMessage(const Ton::Transaction &data);
 [[nodiscard]] bool IsServiceTransaction(const Ton::Transaction &data);
 [[nodiscard]] QString ExtractMessage(const Ton::Transaction &data);
@@ -199,6 +199,8 @@ void Cover::setupBalance() {
           },
           locked->lifetime());
 
+  Ui::TokenIconsUpdated() | rpl::start_with_next([=] { locked->update(); }, locked->lifetime());
+
   std::move(lockedAmount) | rpl::map([](const QString &text) { return text.isEmpty(); }) |
       rpl::distinct_until_changed() |
       rpl::start_with_next([=](bool showLabel) { label->setVisible(showLabel); }, label->lifetime());
@@ -355,6 +355,8 @@ void DePoolInfo::setupControls(rpl::producer<DePoolInfoState> &&state) {
             },
             lifetime());
 
+  Ui::TokenIconsUpdated() | rpl::start_with_next([=] { stakesWrapper->update(); }, lifetime());
+
   rpl::duplicate(state)  //
       | rpl::start_with_next(
             [=](const DePoolInfoState &state) {
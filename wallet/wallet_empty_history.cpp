@@ -35,7 +35,8 @@ rpl::lifetime &EmptyHistory::lifetime() {
 }
 
 void EmptyHistory::setupControls(rpl::producer<EmptyHistoryState> &&state) {
-  const auto lottie = _widget.lifetime().make_state<Ui::LottieAnimation>(&_widget, Ui::LottieFromResource("empty"));
+  const auto lottie = _widget.lifetime().make_state<Ui::LottieAnimation>(&_widget, "empty",
+                                                                       st::walletEmptyLottieSize);
   lottie->stopOnLoop(1);
   lottie->start();
 
@@ -6,13 +6,206 @@
 //
 #include "wallet/wallet_export.h"
 
+#include "wallet/wallet_common.h"
 #include "wallet/wallet_phrases.h"
 #include "wallet/create/wallet_create_view.h"
 #include "ui/widgets/buttons.h"
+#include "ui/widgets/labels.h"
 #include "styles/style_layers.h"
 #include "styles/style_wallet.h"
 
+#include <QtCore/QDateTime>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+
 namespace Wallet {
+namespace {
+
+constexpr auto kErrorsInRowMax = 3;
+
+struct ExportedTransaction {
+  QString lt;
+  QString hash;
+  QString time;
+  QString amount;
+  QString fee;
+  QString address;
+  QString comment;
+};
+
+[[nodiscard]] ExportedTransaction PrepareTransaction(const Ton::Transaction &data, const Ton::Symbol &symbol) {
+  auto amount = int128();
+  auto address = QString();
+  if (symbol.isToken()) {
+    v::match(
+        data.additional,
+        [&](const Ton::TokenTransfer &transfer) {
+          amount = transfer.incoming ? transfer.value : int128(-transfer.value);
+          address = transfer.address;
+        },
+        [&](const Ton::TokenSwapBack &swapBack) {
+          amount = -swapBack.value;
+          address = swapBack.address;
+        },
+        [&](const Ton::TokenMint &mint) { amount = mint.value; },
+        [&](const Ton::TokensBounced &bounced) { amount = bounced.amount; },
+        [](auto &&) {});
+  } else {
+    amount = IsServiceTransaction(data) ? int128() : int128(CalculateValue(data));
+    address = ExtractAddress(data);
+  }
+  return ExportedTransaction{
+      .lt = QString::number(data.id.lt),
+      .hash = QString::fromLatin1(data.id.hash.toHex()),
+      .time = QDateTime::fromSecsSinceEpoch(data.time, Qt::UTC).toString(Qt::ISODate),
+      .amount = FormatAmount(amount, symbol, FormatFlag::Simple | FormatFlag::Signed).full,
+      .fee = FormatAmount(data.fee, Ton::Symbol::ton(), FormatFlag::Simple).full,
+      .address = address,
+      .comment = IsEncryptedMessage(data) ? QString() : ExtractMessage(data),
+  };
+}
+
+[[nodiscard]] QByteArray EscapeCsv(const QString &value) {
+  auto result = value.toUtf8();
+  if (result.contains('"') || result.contains(',') || result.contains('\n') || result.contains('\r')) {
+    result.replace('"', "\"\"");
+    return '"' + result + '"';
+  }
+  return result;
+}
+
+[[nodiscard]] QByteArray SerializeCsv(const ExportedTransaction &data) {
+  return EscapeCsv(data.lt) + ',' + EscapeCsv(data.hash) + ',' + EscapeCsv(data.time) + ',' + EscapeCsv(data.amount) +
+         ',' + EscapeCsv(data.fee) + ',' + EscapeCsv(data.address) + ',' + EscapeCsv(data.comment) + '\n';
+}
+
+[[nodiscard]] QByteArray SerializeJson(const ExportedTransaction &data) {
+  return QJsonDocument(QJsonObject{
+                           {"lt", data.lt},
+                           {"hash", data.hash},
+                           {"time", data.time},
+                           {"amount", data.amount},
+                           {"fee", data.fee},
+                           {"address", data.address},
+                           {"comment", data.comment},
+                       })
+      .toJson(QJsonDocument::Compact);
+}
+
+}  // namespace
+
+HistoryExport::HistoryExport(HistoryPageKey page, const QString &path, HistoryExportFormat format, Preload preload)
+    : _page(std::move(page)), _format(format), _preload(std::move(preload)), _file(path) {
+}
+
+HistoryExport::~HistoryExport() = default;
+
+void HistoryExport::start(const Ton::TransactionsSlice &latest) {
+  if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    finish(true);
+    return;
+  }
+  _started = crl::now();
+  const auto header = (_format == HistoryExportFormat::Json)  //
+                          ? QByteArray("[\n")
+                          : QByteArray("lt,hash,time,amount,fee,address,comment\n");
+  if (_file.write(header) != header.size()) {
+    finish(true);
+    return;
+  }
+  write(latest.list);
+  next(latest.previousId);
+}
+
+void HistoryExport::cancel() {
+  if (_progress.finished) {
+    return;
+  }
+  _requested = std::nullopt;
+  _file.close();
+  _file.remove();
+}
+
+bool HistoryExport::waits(const HistoryPageKey &page, const Ton::LoadedSlice &slice) const {
+  // Slices preloaded by the history itself are skipped, only the requested one continues the file.
+  const auto &list = slice.data.list;
+  return _requested.has_value() && page == _page && (list.empty() || list.front().id == *_requested);
+}
+
+void HistoryExport::apply(const Ton::LoadedSlice &slice) {
+  Expects(_requested.has_value());
+
+  _requested = std::nullopt;
+  _errorsInRow = 0;
+  write(slice.data.list);
+  if (slice.data.list.empty()) {
+    finish(false);
+  } else {
+    next(slice.data.previousId);
+  }
+}
+
+void HistoryExport::retry() {
+  // The errors are not bound to a request, so any of them repeats the one
+  // waited for and only several in a row without a slice fail the export.
+  if (!_requested.has_value()) {
+    return;
+  } else if (++_errorsInRow >= kErrorsInRowMax) {
+    finish(true);
+  } else {
+    _preload(_page, *_requested);
+  }
+}
+
+rpl::producer<HistoryExportProgress> HistoryExport::progress() const {
+  return rpl::single(_progress) | rpl::then(_progressChanges.events());
+}
+
+void HistoryExport::write(const std::vector<Ton::Transaction> &list) {
+  if (!_file.isOpen()) {
+    return;
+  }
+  for (const auto &transaction : list) {
+    const auto prepared = PrepareTransaction(transaction, _page.first);
+    const auto serialized = (_format == HistoryExportFormat::Json)  //
+                                ? ((_progress.transactions ? QByteArray(",\n") : QByteArray()) + SerializeJson(prepared))
+                                : SerializeCsv(prepared);
+    if (_file.write(serialized) != serialized.size()) {
+      finish(true);
+      return;
+    }
+    ++_progress.transactions;
+  }
+  _progress.bytes = _file.pos();
+  _progress.perSecond = int(_progress.transactions * 1000LL / std::max(crl::now() - _started, crl::time(1)));
+  _progressChanges.fire_copy(_progress);
+}
+
+void HistoryExport::next(const Ton::TransactionId &previousId) {
+  if (!_file.isOpen()) {
+    return;
+  } else if (!previousId.lt) {
+    finish(false);
+    return;
+  }
+  _requested = previousId;
+  _preload(_page, previousId);
+}
+
+void HistoryExport::finish(bool failed) {
+  if (!failed && _format == HistoryExportFormat::Json) {
+    const auto footer = QByteArray("\n]\n");
+    failed = (_file.write(footer) != footer.size());
+  }
+  _file.close();
+  if (failed) {
+    _file.remove();
+  }
+  _requested = std::nullopt;
+  _progress.finished = true;
+  _progress.failed = failed;
+  _progressChanges.fire_copy(_progress);
+}
 
 void ExportedBox(not_null<Ui::GenericBox *> box, const std::vector<QString> &words) {
   box->setWidth(st::boxWideWidth);
@@ -29,4 +222,40 @@ void ExportedBox(not_null<Ui::GenericBox *> box, const std::vector<QString> &wor
       ->setTextTransform(Ui::RoundButton::TextTransform::NoTransform);
 }
 
+void HistoryExportBox(not_null<Ui::GenericBox *> box, const std::shared_ptr<HistoryExport> &history) {
+  box->setTitle(ph::lng_wallet_export_history_title());
+  box->setStyle(st::walletBox);
+
+  auto text = history->progress()  //
+              | rpl::map([](const HistoryExportProgress &progress) {
+                  const auto count = QString::number(progress.transactions);
+                  if (progress.failed) {
+                    return ph::lng_wallet_export_history_failed(ph::now);
+                  } else if (progress.finished) {
+                    return ph::lng_wallet_export_history_done(ph::now).replace("{count}", count);
+                  }
+                  return ph::lng_wallet_export_history_progress(ph::now)
+                      .replace("{count}", count)
+                      .replace("{speed}", QString::number(progress.perSecond));
+                });
+  box->addRow(object_ptr<Ui::FlatLabel>(box, std::move(text), st::walletLabel));
+
+  box->addButton(ph::lng_wallet_cancel(), [=] { box->closeBox(); }, st::walletBottomButton)
+      ->setTextTransform(Ui::RoundButton::TextTransform::NoTransform);
+
+  history->progress()                                                                      //
+      | rpl::filter([](const HistoryExportProgress &progress) { return progress.finished; })  //
+      | rpl::take(1)                                                                          //
+      | rpl::start_with_next(
+            [=] {
+              box->clearButtons();
+              box->addButton(ph::lng_wallet_done(), [=] { box->closeBox(); }, st::walletBottomButton)
+                  ->setTextTransform(Ui::RoundButton::TextTransform::NoTransform);
+            },
+            box->lifetime());
+
+  // Closing the box before the export is finished cancels it.
+  box->lifetime().add([=] { history->cancel(); });
+}
+
 }  // namespace Wallet
@@ -7,9 +7,65 @@
 #pragma once
 
 #include "ui/layers/generic_box.h"
+#include "base/weak_ptr.h"
+#include "ton/ton_state.h"
+
+#include <QtCore/QFile>
 
 namespace Wallet {
 
+using HistoryPageKey = std::pair<Ton::Symbol, QString>;
+
+enum class HistoryExportFormat {
+  Csv,
+  Json,
+};
+
+struct HistoryExportProgress {
+  int transactions = 0;
+  int64 bytes = 0;
+  int perSecond = 0;
+  bool finished = false;
+  bool failed = false;
+};
+
+// Writes the history of a single page to a file slice by slice, requesting
+// the older slices through the regular preload path as the previous are written.
+// The owner passes the requested slice to apply() and every load error to
+// retry(), the history list still receives all the slices.
+class HistoryExport final : public base::has_weak_ptr {
+ public:
+  using Preload = Fn<void(const HistoryPageKey &, const Ton::TransactionId &)>;
+
+  HistoryExport(HistoryPageKey page, const QString &path, HistoryExportFormat format, Preload preload);
+  ~HistoryExport();
+
+  void start(const Ton::TransactionsSlice &latest);
+  void cancel();
+
+  [[nodiscard]] bool waits(const HistoryPageKey &page, const Ton::LoadedSlice &slice) const;
+  void apply(const Ton::LoadedSlice &slice);
+  void retry();
+
+  [[nodiscard]] rpl::producer<HistoryExportProgress> progress() const;
+
+ private:
+  void write(const std::vector<Ton::Transaction> &list);
+  void next(const Ton::TransactionId &previousId);
+  void finish(bool failed);
+
+  const HistoryPageKey _page;
+  const HistoryExportFormat _format;
+  const Preload _preload;
+  QFile _file;
+  crl::time _started = 0;
+  std::optional<Ton::TransactionId> _requested;
+  int _errorsInRow = 0;
+  HistoryExportProgress _progress;
+  rpl::event_stream<HistoryExportProgress> _progressChanges;
+};
+
 void ExportedBox(not_null<Ui::GenericBox *> box, const std::vector<QString> &words);
+void HistoryExportBox(not_null<Ui::GenericBox *> box, const std::shared_ptr<HistoryExport> &history);
 
 }  // namespace Wallet
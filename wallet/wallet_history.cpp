@@ -7,16 +7,19 @@
 #include "wallet/wallet_history.h"
 
 #include "wallet/wallet_common.h"
+#include "wallet/wallet_history_cache.h"
 #include "wallet/wallet_phrases.h"
 #include "base/unixtime.h"
 #include "base/flags.h"
 #include "base/object_ptr.h"
+#include "base/weak_ptr.h"
 #include "ui/address_label.h"
 #include "ui/inline_token_icon.h"
 #include "ui/painter.h"
 #include "ui/text/text.h"
 #include "ui/rp_widget.h"
 #include "ui/text/text_utilities.h"
+#include "ui/ui_utility.h"
 #include "ui/widgets/buttons.h"
 #include "ui/effects/animations.h"
 #include "styles/style_wallet.h"
@@ -25,14 +28,35 @@
 
 #include <iostream>
 #include <QtCore/QDateTime>
+#include <crl/crl_async.h>
 #include <utility>
 
 namespace Wallet {
 namespace {
 
 constexpr auto kPreloadScreens = 3;
+constexpr auto kPreloadScreensMax = 12;
+constexpr auto kPreloadDefaultLatency = crl::time(500);
+constexpr auto kPreloadRetryTimeout = crl::time(10000);
+constexpr auto kScrollVelocityWindow = crl::time(1000);
+constexpr auto kReleaseScreens = 2 * kPreloadScreens;
 constexpr auto kCommentLinesMax = 3;
 constexpr auto kExecuteVisibleTimeout = 86400;
+constexpr auto kIngestionBudget = crl::time(8);
+constexpr auto kIngestionChunk = 64;
+constexpr auto kRowPoolBlock = 256;
+constexpr auto kAddressWidthCacheMax = 4096;
+
+// Rough sizes of the text layouts and other heap data of a row beyond its pooled
+// slot and of a transaction, inactive pages are evicted once the pooled blocks
+// together with the estimated totals exceed the budget.
+constexpr auto kMemoryBudget = int64(32 * 1024 * 1024);
+constexpr auto kRowBytesEstimate = int64(3072);
+constexpr auto kTransactionBytesEstimate = int64(1024);
+constexpr auto kEvictionKeptTransactions = 16;
+
+constexpr auto kRowVisibleFlag = uchar(0x01);
+constexpr auto kRowShowDateFlag = uchar(0x02);
 
 static const HistoryPageKey kMainPageKey = std::make_pair(Ton::Symbol::ton(), QString{});
 
@@ -70,6 +94,8 @@ struct TransactionLayout {
   QDateTime dateTime;
   Ui::Text::String date;
   Ui::Text::String time;
+  QString dateText;
+  QString timeText;
   Ui::Text::String amountGrams;
   Ui::Text::String amountNano;
   Ui::Text::String address;
@@ -112,52 +138,103 @@ struct MultisigTransactionParams {
   return result;
 }
 
+// Bumped on each server time shift or phrases update, the rows parse their times again lazily.
+int TimeShiftGeneration = 0;
+
+// Widths measured by AddressWidth(), dropped when the style changes.
+auto AddressWidths = QHash<QString, int>();
+
+// Texts built by ShortTimeText() and ShortDateText(), dropped when the phrases change.
+auto ShortTimeTexts = base::flat_map<int, QString>();
+auto ShortDateTexts = base::flat_map<qint64, QString>();
+
+[[nodiscard]] const QString &ShortTimeText(const QTime &time) {
+  const auto minute = time.hour() * 60 + time.minute();
+  auto i = ShortTimeTexts.find(minute);
+  if (i == end(ShortTimeTexts)) {
+    i = ShortTimeTexts.emplace(minute, ph::lng_wallet_short_time(QTime(time.hour(), time.minute()))(ph::now)).first;
+  }
+  return i->second;
+}
+
+// Dates far from the current one get a year, so the texts are dropped when the day changes.
+[[nodiscard]] const QString &ShortDateText(const QDate &date) {
+  static auto cachedFor = QDate();
+  if (const auto today = QDate::currentDate(); cachedFor != today) {
+    cachedFor = today;
+    ShortDateTexts.clear();
+  }
+  const auto day = date.toJulianDay();
+  auto i = ShortDateTexts.find(day);
+  if (i == end(ShortDateTexts)) {
+    i = ShortDateTexts.emplace(day, ph::lng_wallet_short_date(date)(ph::now)).first;
+  }
+  return i->second;
+}
+
 void refreshTimeTexts(TransactionLayout &layout, bool forceDateText = false) {
   layout.dateTime = base::unixtime::parse(layout.serverTime);
-  layout.time.setText(st::defaultTextStyle, ph::lng_wallet_short_time(layout.dateTime.time())(ph::now));
+  const auto &time = ShortTimeText(layout.dateTime.time());
+  if (layout.timeText != time) {
+    layout.timeText = time;
+    layout.time.setText(st::defaultTextStyle, time);
+  }
   if (layout.date.isEmpty() && !forceDateText) {
     return;
   }
-  if (layout.flags & Flag::Pending) {
-    layout.date.setText(st::semiboldTextStyle, ph::lng_wallet_row_pending_date(ph::now));
-  } else {
-    layout.date.setText(st::semiboldTextStyle, ph::lng_wallet_short_date(layout.dateTime.date())(ph::now));
+  const auto date = (layout.flags & Flag::Pending) ? ph::lng_wallet_row_pending_date(ph::now)
+                                                   : ShortDateText(layout.dateTime.date());
+  if (layout.date.isEmpty() || layout.dateText != date) {
+    layout.dateText = date;
+    layout.date.setText(st::semiboldTextStyle, date);
   }
 }
 
-[[nodiscard]] TransactionLayout prepareRegularLayout(const Ton::Transaction &data, const Fn<void()> &decrypt,
-                                                     const RegularTransactionParams &params) {
+// Everything which doesn't touch fonts, phrases or text shaping,
+// so that it can be prepared off the main thread.
+struct TransactionLayoutData {
+  TimeId serverTime = 0;
+  QString amountGrams;
+  QString amountNano;
+  QString address;
+  QString measuredAddress;
+  QString comment;
+  QString fee;
+  QString additionalInfo;
+  std::optional<Ton::EthEventStatus> ethEventStatus;
+  std::optional<Ton::TonEventStatus> tonEventStatus;
+  int lineCount = 2;
+  Flags flags = Flags();
+  TransactionType type = TransactionType::Transfer;
+};
+
+void setAmount(TransactionLayoutData &data, const FormattedAmount &amount) {
+  data.amountGrams = amount.gramsString;
+  data.amountNano = amount.separator + amount.nanoString;
+}
+
+[[nodiscard]] TransactionLayoutData prepareRegularLayout(const Ton::Transaction &data, bool canDecrypt,
+                                                         const RegularTransactionParams &params) {
   const auto service = IsServiceTransaction(data);
-  const auto encrypted = IsEncryptedMessage(data) && decrypt;
-  const auto amount = FormatAmount(service ? (-data.fee) : CalculateValue(data), Ton::Symbol::ton(),
-                                   FormatFlag::Signed | FormatFlag::Rounded);
+  const auto encrypted = IsEncryptedMessage(data) && canDecrypt;
   const auto incoming = !data.incoming.source.isEmpty();
   const auto pending = (data.id.lt == 0);
 
   const auto extractedAddress = ExtractAddress(data);
-  const auto address = extractedAddress.isEmpty() ? QString{} : Ton::Wallet::ConvertIntoRaw(extractedAddress);
-  const auto addressPartWidth = [&](int from, int length = -1) {
-    return addressStyle().font->width(address.mid(from, length));
-  };
+  const auto address = extractedAddress.isEmpty() ? QString{} : RawAddress(extractedAddress);
 
-  auto result = TransactionLayout();
+  auto result = TransactionLayoutData();
   result.serverTime = data.time;
 
   if (!params.brief) {
-    result.amountGrams.setText(st::walletRowGramsStyle, amount.gramsString);
-    result.amountNano.setText(st::walletRowNanoStyle, amount.separator + amount.nanoString);
+    setAmount(result, FormatAmount(service ? (-data.fee) : CalculateValue(data), Ton::Symbol::ton(),
+                                   FormatFlag::Signed | FormatFlag::Rounded));
   }
 
-  result.address =
-      Ui::Text::String(addressStyle(), service ? QString() : address, _defaultOptions, st::walletAddressWidthMin);
-  result.addressWidth = (addressStyle().font->spacew / 2) +
-                        std::max(addressPartWidth(0, address.size() / 2), addressPartWidth(address.size() / 2));
-  result.addressHeight = addressStyle().font->height * 2;
-  result.comment = Ui::Text::String(st::walletAddressWidthMin);
-  result.comment.setText(st::defaultTextStyle, (encrypted ? QString() : ExtractMessage(data)), _textPlainOptions);
-
-  const auto fee = FormatAmount(data.fee, Ton::Symbol::ton()).full;
-  result.fees.setText(st::defaultTextStyle, ph::lng_wallet_row_fees(ph::now).replace("{amount}", fee));
+  result.address = service ? QString() : address;
+  result.measuredAddress = address;
+  result.comment = encrypted ? QString() : ExtractMessage(data);
+  result.fee = FormatAmount(data.fee, Ton::Symbol::ton()).full;
 
   result.flags = Flag(0)                                    //
                  | (service ? Flag::Service : Flag(0))      //
@@ -167,11 +244,11 @@ void refreshTimeTexts(TransactionLayout &layout, bool forceDateText = false) {
   result.type = v::match(
       data.additional,
       [&](const Ton::EthEventStatusChanged &event) {
-        result.additionalInfo = ph::lng_wallet_eth_event_status(event.status)(ph::now);
+        result.ethEventStatus = event.status;
         return TransactionType::EthEventStatusChanged;
       },
       [&](const Ton::TonEventStatusChanged &event) {
-        result.additionalInfo = ph::lng_wallet_ton_event_status(event.status)(ph::now);
+        result.tonEventStatus = event.status;
         return TransactionType::TonEventStatusChanged;
       },
       [](const Ton::TokenWalletDeployed &deployed) { return TransactionType::TokenWalletDeployed; },
@@ -186,41 +263,32 @@ void refreshTimeTexts(TransactionLayout &layout, bool forceDateText = false) {
           return TransactionType::Transfer;
         }
       });
-
-  refreshTimeTexts(result);
   return result;
 }
 
-[[nodiscard]] TransactionLayout prepareMultisigLayout(const Ton::Transaction &data,
-                                                      const MultisigTransactionParams &params) {
-  const auto amount = FormatAmount(CalculateValue(data), Ton::Symbol::ton(), FormatFlag::Signed | FormatFlag::Rounded);
+[[nodiscard]] TransactionLayoutData prepareMultisigLayout(const Ton::Transaction &data,
+                                                          const MultisigTransactionParams &params) {
   const auto incoming = !data.incoming.source.isEmpty();
   const auto pending = (data.id.lt == 0);
 
   const auto extractedAddress = ExtractAddress(data);
-  const auto address = extractedAddress.isEmpty() ? QString{} : Ton::Wallet::ConvertIntoRaw(extractedAddress);
-  const auto partWidth = [](const QString &address, int from, int length = -1) {
-    return addressStyle().font->width(address.mid(from, length));
-  };
+  const auto address = extractedAddress.isEmpty() ? QString{} : RawAddress(extractedAddress);
 
-  auto result = TransactionLayout();
+  auto result = TransactionLayoutData();
   result.serverTime = data.time;
 
   const auto setAddress = [&] {
-    result.address = Ui::Text::String(addressStyle(), address, _defaultOptions, st::walletAddressWidthMin);
-    result.addressWidth = (addressStyle().font->spacew / 2) +
-                          std::max(partWidth(address, 0, address.size() / 2), partWidth(address, address.size() / 2));
-    result.addressHeight = addressStyle().font->height * 2;
+    result.address = address;
+    result.measuredAddress = address;
   };
 
   auto showAmount = false;
-  QString comment;
   v::match(
       data.additional,
       [&](const Ton::MultisigDeploymentTransaction &) { result.type = TransactionType::MultisigDeployment; },
       [&](const Ton::MultisigSubmitTransaction &submitTransaction) {
         showAmount = submitTransaction.executed;
-        comment = submitTransaction.comment;
+        result.comment = submitTransaction.comment;
 
         if (!submitTransaction.executed) {
           switch (params.submitTransactionStatus) {
@@ -243,55 +311,45 @@ void refreshTimeTexts(TransactionLayout &layout, bool forceDateText = false) {
         } else {
           result.type = TransactionType::MultisigSubmit;
 
-          const auto dest = Ton::Wallet::ConvertIntoRaw(submitTransaction.dest);
+          const auto dest = RawAddress(submitTransaction.dest);
           const auto requestedAmount = FormatAmount(submitTransaction.amount, Ton::Symbol::ton());
 
-          const auto text = QString{"Amount: %1 TON\n\nTransactionId:\n%2\n\nDestination:\n%3\n%4"}
-                                .arg(requestedAmount.full)
-                                .arg(FormatTransactionId(submitTransaction.transactionId))
-                                .arg(dest.mid(0, dest.size() / 2))
-                                .arg(dest.mid(dest.size() / 2, -1));
+          result.address = QString{"Amount: %1 TON\n\nTransactionId:\n%2\n\nDestination:\n%3\n%4"}
+                               .arg(requestedAmount.full)
+                               .arg(FormatTransactionId(submitTransaction.transactionId))
+                               .arg(dest.mid(0, dest.size() / 2))
+                               .arg(dest.mid(dest.size() / 2, -1));
+          result.measuredAddress = dest;
           result.lineCount = 9;
-          result.address = Ui::Text::String(addressStyle(), text, _defaultOptions, st::walletAddressWidthMin);
-          result.addressWidth = (addressStyle().font->spacew / 2) +
-                                std::max(partWidth(dest, 0, dest.size() / 2), partWidth(dest, dest.size() / 2));
-          result.addressHeight = addressStyle().font->height * result.lineCount;
         }
       },
       [&](const Ton::MultisigConfirmTransaction &confirmTransaction) {
         showAmount = confirmTransaction.executed;
-        comment = ExtractMessage(data);
+        result.comment = ExtractMessage(data);
         result.additionalInfo = FormatTransactionId(confirmTransaction.transactionId);
         result.type = TransactionType::MultisigConfirm;
         setAddress();
       },
       [&](auto &&) {
         showAmount = true;
-        comment = ExtractMessage(data);
+        result.comment = ExtractMessage(data);
         result.type = TransactionType::Transfer;
         setAddress();
       });
 
   if (showAmount) {
-    result.amountGrams.setText(st::walletRowGramsStyle, amount.gramsString);
-    result.amountNano.setText(st::walletRowNanoStyle, amount.separator + amount.nanoString);
+    setAmount(result,
+              FormatAmount(CalculateValue(data), Ton::Symbol::ton(), FormatFlag::Signed | FormatFlag::Rounded));
   }
-
-  result.comment = Ui::Text::String(st::walletAddressWidthMin);
-  result.comment.setText(st::defaultTextStyle, comment, _textPlainOptions);
-
-  const auto fee = FormatAmount(data.fee, Ton::Symbol::ton()).full;
-  result.fees.setText(st::defaultTextStyle, ph::lng_wallet_row_fees(ph::now).replace("{amount}", fee));
+  result.fee = FormatAmount(data.fee, Ton::Symbol::ton()).full;
 
   result.flags = Flag(0)                                  //
                  | (incoming ? Flag::Incoming : Flag(0))  //
                  | (pending ? Flag::Pending : Flag(0));
-
-  refreshTimeTexts(result);
   return result;
 }
 
-[[nodiscard]] std::optional<TransactionLayout> prepareDePoolLayout(const Ton::Transaction &data) {
+[[nodiscard]] std::optional<TransactionLayoutData> prepareDePoolLayout(const Ton::Transaction &data) {
   using Properties = std::optional<std::tuple<int64, int64, TransactionType>>;
   auto properties = v::match(
       data.additional,
@@ -309,42 +367,27 @@ void refreshTimeTexts(TransactionLayout &layout, bool forceDateText = false) {
   }
   const auto [value, fee, type] = std::move(*properties);
 
-  const auto token = Ton::Symbol::ton();
-
-  const auto amount = FormatAmount(value, token, FormatFlag::Signed | FormatFlag::Rounded);
-
   const auto incoming = !data.incoming.source.isEmpty();
   const auto pending = (data.id.lt == 0);
-  const auto address = Ton::Wallet::ConvertIntoRaw(ExtractAddress(data));
-  const auto addressPartWidth = [&](int from, int length = -1) {
-    return addressStyle().font->width(address.mid(from, length));
-  };
 
-  auto result = TransactionLayout();
+  auto result = TransactionLayoutData();
   result.serverTime = data.time;
-  result.amountGrams.setText(st::walletRowGramsStyle, amount.gramsString);
-  result.amountNano.setText(st::walletRowNanoStyle, amount.separator + amount.nanoString);
-  result.address = Ui::Text::String(addressStyle(), address, _defaultOptions, st::walletAddressWidthMin);
-  result.addressWidth = (addressStyle().font->spacew / 2) +
-                        std::max(addressPartWidth(0, address.size() / 2), addressPartWidth(address.size() / 2));
-  result.addressHeight = addressStyle().font->height * 2;
-  result.comment = Ui::Text::String(st::walletAddressWidthMin);
-  result.comment.setText(st::defaultTextStyle, {}, _textPlainOptions);
-
-  result.fees.setText(st::defaultTextStyle,
-                      ph::lng_wallet_row_fees(ph::now).replace("{amount}", FormatAmount(fee, Ton::Symbol::ton()).full));
+  setAmount(result, FormatAmount(value, Ton::Symbol::ton(), FormatFlag::Signed | FormatFlag::Rounded));
+  result.address = RawAddress(ExtractAddress(data));
+  result.measuredAddress = result.address;
+  result.fee = FormatAmount(fee, Ton::Symbol::ton()).full;
 
   result.flags = Flag(0)                                  //
                  | (incoming ? Flag::Incoming : Flag(0))  //
                  | (pending ? Flag::Pending : Flag(0));
   result.type = type;
-
-  refreshTimeTexts(result);
   return result;
 }
 
-[[nodiscard]] std::optional<TransactionLayout> prepareTokenLayout(const Ton::Symbol &token,
-                                                                  const Ton::Transaction &transaction) {
+// Direct transfers show the owner of the counterparty token wallet once it is resolved.
+[[nodiscard]] std::optional<TransactionLayoutData> prepareTokenLayout(const Ton::Symbol &token,
+                                                                      const Ton::Transaction &transaction,
+                                                                      const QString &owner) {
   using Properties = std::optional<std::tuple<QString, int128, bool, TransactionType>>;
   auto properties = v::match(
       transaction.additional,
@@ -352,16 +395,18 @@ void refreshTimeTexts(TransactionLayout &layout, bool forceDateText = false) {
         return std::make_tuple(QString{}, 0, /*incoming*/ true, TransactionType::TokenWalletDeployed);
       },
       [&](const Ton::EthEventStatusChanged &ethEventStatusChanged) -> Properties {
-        return std::make_tuple(Ton::Wallet::ConvertIntoRaw(transaction.incoming.source), 0, /*incoming*/ true,
+        return std::make_tuple(RawAddress(transaction.incoming.source), 0, /*incoming*/ true,
                                TransactionType::EthEventStatusChanged);
       },
       [&](const Ton::TonEventStatusChanged &tonEventStatusChanged) -> Properties {
-        return std::make_tuple(Ton::Wallet::ConvertIntoRaw(transaction.incoming.source), 0, /*incoming*/ true,
+        return std::make_tuple(RawAddress(transaction.incoming.source), 0, /*incoming*/ true,
                                TransactionType::TonEventStatusChanged);
       },
-      [](const Ton::TokenTransfer &transfer) -> Properties {
-        return std::make_tuple(transfer.direct ? Ton::kZeroAddress : Ton::Wallet::ConvertIntoRaw(transfer.address),
-                               transfer.value, transfer.incoming, TransactionType::Transfer);
+      [&](const Ton::TokenTransfer &transfer) -> Properties {
+        const auto address = !transfer.direct   ? RawAddress(transfer.address)
+                             : owner.isEmpty() ? Ton::kZeroAddress
+                                               : RawAddress(owner);
+        return std::make_tuple(address, transfer.value, transfer.incoming, TransactionType::Transfer);
       },
       [](const Ton::TokenMint &tokenMint) -> Properties {
         return std::make_tuple(QString{}, tokenMint.value, /*incoming*/ true, TransactionType::Mint);
@@ -379,83 +424,322 @@ void refreshTimeTexts(TransactionLayout &layout, bool forceDateText = false) {
   }
   const auto [address, value, incoming, type] = std::move(*properties);
 
-  const auto amount = FormatAmount(incoming ? value : -value, token, FormatFlag::Signed | FormatFlag::Rounded);
-  const auto addressPartWidth = [address = std::ref(address)](int from, int length = -1) {
-    return addressStyle().font->width(address.get().mid(from, length));
-  };
-
-  auto result = TransactionLayout();
+  auto result = TransactionLayoutData();
   result.serverTime = transaction.time;
-  result.amountGrams.setText(st::walletRowGramsStyle, amount.gramsString);
-  result.amountNano.setText(st::walletRowNanoStyle, amount.separator + amount.nanoString);
-  result.address = Ui::Text::String(addressStyle(), address, _defaultOptions, st::walletAddressWidthMin);
-  result.addressWidth = (addressStyle().font->spacew / 2) +
-                        std::max(addressPartWidth(0, address.size() / 2), addressPartWidth(address.size() / 2));
-  result.addressHeight = addressStyle().font->height * 2;
-  result.comment = Ui::Text::String(st::walletAddressWidthMin);
-  result.comment.setText(st::defaultTextStyle, {}, _textPlainOptions);
-
-  const auto fee = FormatAmount(CalculateValue(transaction), Ton::Symbol::ton()).full;
-  result.fees.setText(st::defaultTextStyle, ph::lng_wallet_row_fees(ph::now).replace("{amount}", fee));
+  setAmount(result, FormatAmount(incoming ? value : -value, token, FormatFlag::Signed | FormatFlag::Rounded));
+  result.address = address;
+  result.measuredAddress = address;
+  result.fee = FormatAmount(CalculateValue(transaction), Ton::Symbol::ton()).full;
 
   result.flags = incoming ? Flag::Incoming : Flag(0);
   result.type = type;
+  return result;
+}
+
+// Width of an address split into two lines, measured once per counterparty.
+[[nodiscard]] int AddressWidth(const QString &address) {
+  const auto i = AddressWidths.constFind(address);
+  if (i != AddressWidths.cend()) {
+    return *i;
+  }
+  if (AddressWidths.size() >= kAddressWidthCacheMax) {
+    AddressWidths.clear();
+  }
+  const auto &font = addressStyle().font;
+  const auto half = address.size() / 2;
+  const auto result = (font->spacew / 2) + std::max(font->width(address.mid(0, half)), font->width(address.mid(half)));
+  AddressWidths.insert(address, result);
+  return result;
+}
+
+// Main thread part, shapes the texts of the prepared data.
+[[nodiscard]] TransactionLayout buildLayout(TransactionLayoutData &&data) {
+  auto result = TransactionLayout();
+  result.serverTime = data.serverTime;
+  if (!data.amountGrams.isEmpty()) {
+    result.amountGrams.setText(st::walletRowGramsStyle, data.amountGrams);
+    result.amountNano.setText(st::walletRowNanoStyle, data.amountNano);
+  }
+  result.address = Ui::Text::String(addressStyle(), data.address, _defaultOptions, st::walletAddressWidthMin);
+  result.lineCount = data.lineCount;
+  result.addressWidth = AddressWidth(data.measuredAddress);
+  result.addressHeight = addressStyle().font->height * result.lineCount;
+  result.comment = Ui::Text::String(st::walletAddressWidthMin);
+  result.comment.setText(st::defaultTextStyle, data.comment, _textPlainOptions);
+  result.fees.setText(st::defaultTextStyle, ph::lng_wallet_row_fees(ph::now).replace("{amount}", data.fee));
+
+  if (data.ethEventStatus.has_value()) {
+    result.additionalInfo = ph::lng_wallet_eth_event_status(*data.ethEventStatus)(ph::now);
+  } else if (data.tonEventStatus.has_value()) {
+    result.additionalInfo = ph::lng_wallet_ton_event_status(*data.tonEventStatus)(ph::now);
+  } else {
+    result.additionalInfo = std::move(data.additionalInfo);
+  }
+  result.flags = data.flags;
+  result.type = data.type;
 
   refreshTimeTexts(result);
   return result;
 }
 
+[[nodiscard]] bool hasTokenLayout(const Ton::Transaction &transaction) {
+  return v::match(
+      transaction.additional,
+      [](const Ton::TokenWalletDeployed &) { return true; },
+      [](const Ton::EthEventStatusChanged &) { return true; },
+      [](const Ton::TonEventStatusChanged &) { return true; },
+      [](const Ton::TokenTransfer &) { return true; },
+      [](const Ton::TokenMint &) { return true; },
+      [](const Ton::TokenSwapBack &) { return true; },
+      [](const Ton::TokensBounced &) { return true; },
+      [](auto &&) { return false; });
+}
+
+[[nodiscard]] bool hasDePoolLayout(const Ton::Transaction &transaction) {
+  return v::match(
+      transaction.additional,
+      [](const Ton::DePoolOrdinaryStakeTransaction &) { return true; },
+      [](const Ton::DePoolOnRoundCompleteTransaction &) { return true; },
+      [](auto &&) { return false; });
+}
+
+[[nodiscard]] std::vector<TransactionPtr> ShareTransactions(std::vector<Ton::Transaction>::const_iterator from,
+                                                           std::vector<Ton::Transaction>::const_iterator till) {
+  auto result = std::vector<TransactionPtr>();
+  result.reserve(till - from);
+  for (; from != till; ++from) {
+    result.push_back(std::make_shared<const Ton::Transaction>(*from));
+  }
+  return result;
+}
+
+// Cheap row height guess used until the row gets close enough to the viewport
+// to have its TransactionLayout prepared. Doesn't include the date header.
+[[nodiscard]] int estimateHeight(const Ton::Transaction &transaction) {
+  const auto addressLines = v::match(
+      transaction.additional,
+      [](const Ton::MultisigSubmitTransaction &submitTransaction) { return submitTransaction.executed ? 2 : 9; },
+      [](auto &&) { return 2; });
+
+  const auto padding = st::walletRowPadding;
+  auto result = padding.top() + std::max(st::walletRowGramsStyle.font->height, st::normalFont->height);
+  result += st::walletRowAddressTop + addressStyle().font->height * addressLines;
+  if (!ExtractMessage(transaction).isEmpty()) {
+    result += st::walletRowCommentTop + st::defaultTextStyle.font->height;
+  }
+  result += st::walletRowFeesTop + st::defaultTextStyle.font->height;
+  return result + padding.bottom();
+}
+
+// Rows are created and destroyed by thousands on page switches, so they are
+// taken from fixed size blocks. A block is given back to the allocator once
+// all of its rows are gone, except for a single spare one. Main thread only.
+class RowPool final {
+ public:
+  explicit RowPool(std::size_t size)
+      : _slotSize(((std::max(size, sizeof(void *)) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t)) *
+                  alignof(std::max_align_t)) {
+  }
+
+  [[nodiscard]] void *allocate() {
+    if (!_current || !_current->free) {
+      const auto i = ranges::find_if(_blocks, [](const std::unique_ptr<Block> &block) { return block->free; });
+      _current = (i != end(_blocks)) ? i->get() : grow();
+    }
+    if (_current == _spare) {
+      _spare = nullptr;
+    }
+    ++_current->used;
+    return std::exchange(_current->free, *static_cast<void **>(_current->free));
+  }
+  void release(void *slot) {
+    // Blocks are sorted by address, the slot belongs to the last one starting before it.
+    const auto i = std::upper_bound(begin(_blocks), end(_blocks), static_cast<std::byte *>(slot),
+                                    [](std::byte *slot, const std::unique_ptr<Block> &block) {
+                                      return std::less<>()(slot, block->memory.get());
+                                    });
+    Assert(i != begin(_blocks));
+    const auto block = std::prev(i)->get();
+    *static_cast<void **>(slot) = block->free;
+    block->free = slot;
+    if (--block->used > 0) {
+      return;
+    } else if (!_spare) {
+      _spare = block;
+      return;
+    }
+    if (_current == block) {
+      _current = nullptr;
+    }
+    _blocks.erase(std::prev(i));
+  }
+
+  // Memory actually held by the blocks, including their free slots.
+  [[nodiscard]] int64 reservedBytes() const {
+    return int64(_blocks.size()) * int64(_slotSize) * kRowPoolBlock;
+  }
+
+ private:
+  struct Block {
+    std::unique_ptr<std::byte[]> memory;
+    void *free = nullptr;
+    int used = 0;
+  };
+
+  [[nodiscard]] Block *grow() {
+    auto block = std::make_unique<Block>();
+    block->memory = std::make_unique<std::byte[]>(_slotSize * kRowPoolBlock);
+    for (auto i = kRowPoolBlock; i != 0;) {
+      const auto slot = block->memory.get() + _slotSize * --i;
+      *reinterpret_cast<void **>(slot) = block->free;
+      block->free = slot;
+    }
+    const auto memory = block->memory.get();
+    const auto i = std::upper_bound(begin(_blocks), end(_blocks), memory,
+                                    [](std::byte *memory, const std::unique_ptr<Block> &block) {
+                                      return std::less<>()(memory, block->memory.get());
+                                    });
+    return _blocks.insert(i, std::move(block))->get();
+  }
+
+  const std::size_t _slotSize = 0;
+  std::vector<std::unique_ptr<Block>> _blocks;
+  Block *_current = nullptr;
+  Block *_spare = nullptr;
+};
+
 }  // namespace
 
-class HistoryRow final {
+class HistoryRow final : public base::has_weak_ptr {
  public:
-  explicit HistoryRow(Ton::Transaction transaction, const Fn<void()> &decrypt = nullptr)
+  [[nodiscard]] static void *operator new(std::size_t size);
+  static void operator delete(void *slot);
+
+  // Called on a worker thread, so it must capture only plain values.
+  using PrepareLayout = Fn<TransactionLayoutData(const Ton::Transaction &)>;
+
+  struct LayoutTask {
+    PrepareLayout prepare;
+    TransactionPtr transaction;
+    int generation = 0;
+  };
+
+  explicit HistoryRow(TransactionPtr transaction, const Fn<void()> &decrypt = nullptr)
       : _symbol(Ton::Symbol::ton())
-      , _layout(prepareRegularLayout(transaction, _decrypt, RegularTransactionParams{}))
       , _transaction(std::move(transaction))
-      , _decrypt(decrypt) {
+      , _decrypt(decrypt)
+      , _prepare([canDecrypt = (decrypt != nullptr)](const Ton::Transaction &data) {
+        return prepareRegularLayout(data, canDecrypt, RegularTransactionParams{});
+      }) {
   }
 
   HistoryRow(const HistoryRow &) = delete;
   HistoryRow &operator=(const HistoryRow &) = delete;
 
   [[nodiscard]] const Ton::TransactionId &id() const {
-    return _transaction.id;
+    return _transaction->id;
   }
 
   [[nodiscard]] const QDateTime &date() const {
-    return _layout.dateTime;
+    if (_dateGeneration != TimeShiftGeneration) {
+      _dateTime = base::unixtime::parse(_transaction->time);
+      _dateGeneration = TimeShiftGeneration;
+    }
+    return _dateTime;
   }
 
   [[nodiscard]] const Ton::Transaction &transaction() const {
-    return _transaction;
+    return *_transaction;
   }
-  [[nodiscard]] Ton::Transaction &transaction() {
+  [[nodiscard]] const TransactionPtr &sharedTransaction() const {
     return _transaction;
   }
+  // A copy with the resolved owner for a direct token transfer, the shared one otherwise.
+  [[nodiscard]] TransactionPtr viewTransaction() const {
+    const auto transfer = std::get_if<Ton::TokenTransfer>(&_transaction->additional);
+    if (_kind != LayoutKind::Token || _owner.isEmpty() || !transfer || !transfer->direct) {
+      return _transaction;
+    }
+    auto result = std::make_shared<Ton::Transaction>(*_transaction);
+    auto &resolved = v::get<Ton::TokenTransfer>(result->additional);
+    resolved.address = _owner;
+    resolved.direct = false;
+    return result;
+  }
+
+  void replaceTransaction(TransactionPtr transaction) {
+    _transaction = std::move(transaction);
+    _dateGeneration = -1;
+    _decryptionFailed = false;
+    _measuredWidth = 0;
+    ++_generation;
+    if (_layout.has_value()) {
+      rebuildLayout();
+    }
+    _width = 0;
+  }
 
+  // Texts of the rows without a layout are shaped fresh when they get one.
   void refreshDate() {
-    refreshTimeTexts(_layout);
+    if (_layout.has_value() && _textsGeneration != TimeShiftGeneration) {
+      _textsGeneration = TimeShiftGeneration;
+      refreshTimeTexts(*_layout);
+    }
   }
 
   void setShowDate(bool show, const Fn<void()> &repaintDate) {
     _width = 0;
-    if (!show) {
-      _layout.date.clear();
+    _showDate = show;
+    if (show) {
+      _repaintDate = repaintDate;
+    }
+    if (!_layout.has_value()) {
+      return;
+    } else if (!show) {
+      _layout->date.clear();
     } else {
-      _repaintDate = std::move(repaintDate);
-      refreshTimeTexts(_layout, true);
+      refreshTimeTexts(*_layout, true);
     }
   }
 
   void setDecryptionFailed() {
     _width = 0;
+    _measuredWidth = 0;
     _decryptionFailed = true;
-    _layout.comment.setText(st::defaultTextStyle, ph::lng_wallet_decrypt_failed(ph::now), _textPlainOptions);
+    if (_layout.has_value()) {
+      _layout->comment.setText(st::defaultTextStyle, ph::lng_wallet_decrypt_failed(ph::now), _textPlainOptions);
+    }
   }
 
   bool showDate() const {
-    return !_layout.date.isEmpty();
+    return _showDate;
+  }
+
+  [[nodiscard]] bool hasLayout() const {
+    return _layout.has_value();
+  }
+  [[nodiscard]] bool layoutRequested() const {
+    return (_requestedGeneration == _generation);
+  }
+  [[nodiscard]] LayoutTask requestLayout() {
+    _requestedGeneration = _generation;
+    return LayoutTask{.prepare = _prepare, .transaction = _transaction, .generation = _generation};
+  }
+  void cancelLayoutRequest() {
+    _requestedGeneration = -1;
+  }
+  bool applyLayout(int generation, TransactionLayoutData &&data) {
+    if (generation != _generation || _layout.has_value()) {
+      return false;
+    }
+    _requestedGeneration = -1;
+    setLayoutData(std::move(data));
+    resizeToWidth(std::exchange(_width, 0));
+    return true;
+  }
+  void releaseLayout() {
+    _layout.reset();
+    _requestedGeneration = -1;
   }
 
   [[nodiscard]] int top() const {
@@ -465,6 +749,21 @@ class HistoryRow final {
     _top = top;
   }
 
+  [[nodiscard]] int index() const {
+    return _index;
+  }
+  [[nodiscard]] bool inPendingList() const {
+    return _inPendingList;
+  }
+  [[nodiscard]] int listIndex() const {
+    return _listIndex;
+  }
+  void setPosition(int index, bool inPendingList, int listIndex) {
+    _index = index;
+    _inPendingList = inPendingList;
+    _listIndex = listIndex;
+  }
+
   void resizeToWidth(int width) {
     if (_width == width) {
       return;
@@ -474,27 +773,33 @@ class HistoryRow final {
       return;
     }
 
+    const auto dateSkip = _showDate ? st::walletRowDateSkip : 0;
+    if (!_layout.has_value()) {
+      // Keep the last measured height while the layout is released,
+      // so rows outside of the viewport don't jump on re-materialization.
+      _height = dateSkip + ((_measuredWidth == _width) ? _measuredHeight : estimateHeight(*_transaction));
+      return;
+    }
+
     const auto padding = st::walletRowPadding;
     const auto use = std::min(_width, st::walletRowWidthMax);
     const auto avail = use - padding.left() - padding.right();
 
-    _height = 0;
-    if (!_layout.date.isEmpty()) {
-      _height += st::walletRowDateSkip;
-    }
-    _height += padding.top() + std::max(_layout.amountGrams.minHeight(), st::normalFont->height);
-    if (!_layout.address.isEmpty()) {
-      _height += st::walletRowAddressTop + _layout.addressHeight;
+    _measuredHeight = padding.top() + std::max(_layout->amountGrams.minHeight(), st::normalFont->height);
+    if (!_layout->address.isEmpty()) {
+      _measuredHeight += st::walletRowAddressTop + _layout->addressHeight;
     }
-    if (!_layout.comment.isEmpty()) {
+    if (!_layout->comment.isEmpty()) {
       _commentHeight =
-          std::min(_layout.comment.countHeight(avail), st::defaultTextStyle.font->height * kCommentLinesMax);
-      _height += st::walletRowCommentTop + _commentHeight;
+          std::min(_layout->comment.countHeight(avail), st::defaultTextStyle.font->height * kCommentLinesMax);
+      _measuredHeight += st::walletRowCommentTop + _commentHeight;
     }
-    if (!_layout.fees.isEmpty()) {
-      _height += st::walletRowFeesTop + _layout.fees.minHeight();
+    if (!_layout->fees.isEmpty()) {
+      _measuredHeight += st::walletRowFeesTop + _layout->fees.minHeight();
     }
-    _height += padding.bottom();
+    _measuredHeight += padding.bottom();
+    _measuredWidth = _width;
+    _height = dateSkip + _measuredHeight;
   }
   [[nodiscard]] int height() const {
     return _height;
@@ -506,7 +811,7 @@ class HistoryRow final {
   void setVisible(bool visible) {
     if (visible) {
       _height = 1;
-      resizeToWidth(_width);
+      resizeToWidth(std::exchange(_width, 0));
     } else {
       _height = 0;
     }
@@ -519,32 +824,32 @@ class HistoryRow final {
   }
 
   void setRegularLayout(const RegularTransactionParams &params) {
-    resetButton();
-    _symbol = Ton::Symbol::ton();
-    _layout = prepareRegularLayout(_transaction, _decrypt, params);
+    setLayout(LayoutKind::Regular, Ton::Symbol::ton(),
+              [canDecrypt = (_decrypt != nullptr), params](const Ton::Transaction &data) {
+                return prepareRegularLayout(data, canDecrypt, params);
+              });
     setVisible(true);
   }
-  void setTokenTransactionLayout(const Ton::Symbol &symbol) {
-    resetButton();
-    auto layout = prepareTokenLayout(symbol, _transaction);
-    if (layout.has_value()) {
-      _layout = std::move(*layout);
-      _symbol = symbol;
-      setVisible(!_transaction.aborted || _transaction.incoming.bounce);
-    } else {
+  void setTokenTransactionLayout(const Ton::Symbol &symbol, const QString &owner = QString()) {
+    _owner = owner;
+    if (!hasTokenLayout(*_transaction)) {
+      resetButton();
       setVisible(false);
+      return;
     }
+    setLayout(LayoutKind::Token, symbol,
+              [symbol, owner](const Ton::Transaction &data) { return *prepareTokenLayout(symbol, data, owner); });
+    setVisible(!_transaction->aborted || _transaction->incoming.bounce);
   }
   void setDePoolTransactionLayout() {
-    resetButton();
-    auto layout = prepareDePoolLayout(_transaction);
-    if (layout.has_value()) {
-      _layout = std::move(*layout);
-      _symbol = Ton::Symbol::ton();
-      setVisible(true);
-    } else {
+    if (!hasDePoolLayout(*_transaction)) {
+      resetButton();
       setVisible(false);
+      return;
     }
+    setLayout(LayoutKind::DePool, Ton::Symbol::ton(),
+              [](const Ton::Transaction &data) { return *prepareDePoolLayout(data); });
+    setVisible(true);
   }
   void setNotificationLayout(not_null<Ui::RpWidget *> parent, EventType eventType,
                              const RegularTransactionParams &params, const Fn<void()> &openRequest) {
@@ -563,9 +868,8 @@ class HistoryRow final {
     }
   }
   void setMultisigLayout(MultisigTransactionParams params = MultisigTransactionParams{}) {
-    resetButton();
-    _symbol = Ton::Symbol::ton();
-    _layout = prepareMultisigLayout(_transaction, params);
+    setLayout(LayoutKind::Multisig, Ton::Symbol::ton(),
+              [params](const Ton::Transaction &data) { return prepareMultisigLayout(data, params); });
     setVisible(true);
   }
   void setMultisigSubmitTransactionLayout(not_null<Ui::RpWidget *> parent, SubmitTransactionStatus status,
@@ -584,13 +888,15 @@ class HistoryRow final {
     if (!isVisible()) {
       return;
     }
+    Expects(_layout.has_value());
 
+    const auto &layout = *_layout;
     const auto padding = st::walletRowPadding;
     const auto use = std::min(_width, st::walletRowWidthMax);
     const auto avail = use - padding.left() - padding.right();
     x += (_width - use) / 2 + padding.left();
 
-    if (!_layout.date.isEmpty()) {
+    if (_showDate) {
       y += st::walletRowDateSkip;
     } else {
       const auto shadowLeft = (use < _width) ? (x - st::walletRowShadowAdd) : x;
@@ -600,34 +906,34 @@ class HistoryRow final {
     }
     y += padding.top();
 
-    if (_layout.flags & Flag::Service) {
+    if (layout.flags & Flag::Service) {
       const auto labelLeft = x;
       const auto labelTop = y + st::walletRowGramsStyle.font->ascent - st::normalFont->ascent;
       p.setPen(st::windowFg);
       p.setFont(st::normalFont);
       p.drawText(labelLeft, labelTop + st::normalFont->ascent,
-                 ((_layout.flags & Flag::Initialization) ? ph::lng_wallet_row_init(ph::now)
-                                                         : ph::lng_wallet_row_service(ph::now)));
+                 ((layout.flags & Flag::Initialization) ? ph::lng_wallet_row_init(ph::now)
+                                                        : ph::lng_wallet_row_service(ph::now)));
     } else {
-      const auto incoming = (_layout.flags & Flag::Incoming);
+      const auto incoming = (layout.flags & Flag::Incoming);
 
       p.setPen(incoming ? st::boxTextFgGood : st::boxTextFgError);
 
       auto drawIcon = false;
-      if (!_layout.amountGrams.isEmpty()) {
-        _layout.amountGrams.draw(p, x, y, avail);
+      if (!layout.amountGrams.isEmpty()) {
+        layout.amountGrams.draw(p, x, y, avail);
         drawIcon = true;
       }
 
       const auto nanoTop = y + st::walletRowGramsStyle.font->ascent - st::walletRowNanoStyle.font->ascent;
-      const auto nanoLeft = x + _layout.amountGrams.maxWidth();
-      if (!_layout.amountNano.isEmpty()) {
-        _layout.amountNano.draw(p, nanoLeft, nanoTop, avail);
+      const auto nanoLeft = x + layout.amountGrams.maxWidth();
+      if (!layout.amountNano.isEmpty()) {
+        layout.amountNano.draw(p, nanoLeft, nanoTop, avail);
         drawIcon = true;
       }
 
       const auto diamondTop = y + st::walletRowGramsStyle.font->ascent - st::normalFont->ascent;
-      const auto diamondLeft = nanoLeft + _layout.amountNano.maxWidth() + st::normalFont->spacew;
+      const auto diamondLeft = nanoLeft + layout.amountNano.maxWidth() + st::normalFont->spacew;
       if (drawIcon) {
         Ui::PaintInlineTokenIcon(_symbol, p, diamondLeft, diamondTop, st::normalFont);
       }
@@ -637,15 +943,15 @@ class HistoryRow final {
       p.setPen(st::windowFg);
       p.setFont(st::normalFont);
       p.drawText(labelLeft, labelTop + st::normalFont->ascent, [&] {
-        switch (_layout.type) {
+        switch (layout.type) {
           case TransactionType::ExplicitTokenTransfer:
             return ph::lng_wallet_row_token_transfer(ph::now);
           case TransactionType::TokenWalletDeployed:
             return ph::lng_wallet_row_token_wallet_deployed(ph::now);
           case TransactionType::EthEventStatusChanged:
-            return ph::lng_wallet_row_eth_event_notification(ph::now).replace("{value}", _layout.additionalInfo);
+            return ph::lng_wallet_row_eth_event_notification(ph::now).replace("{value}", layout.additionalInfo);
           case TransactionType::TonEventStatusChanged:
-            return ph::lng_wallet_row_ton_event_notification(ph::now).replace("{value}", _layout.additionalInfo);
+            return ph::lng_wallet_row_ton_event_notification(ph::now).replace("{value}", layout.additionalInfo);
           case TransactionType::SwapBack:
             return ph::lng_wallet_row_swap_back_to(ph::now);
           case TransactionType::Mint:
@@ -661,9 +967,9 @@ class HistoryRow final {
           case TransactionType::MultisigDeployment:
             return ph::lng_wallet_row_multisig_deployed(ph::now);
           case TransactionType::MultisigSubmit:
-            return ph::lng_wallet_row_requested_to(ph::now).replace("{additional}", _layout.additionalInfo);
+            return ph::lng_wallet_row_requested_to(ph::now).replace("{additional}", layout.additionalInfo);
           case TransactionType::MultisigConfirm:
-            return ph::lng_wallet_row_confirmed(ph::now).replace("{value}", _layout.additionalInfo);
+            return ph::lng_wallet_row_confirmed(ph::now).replace("{value}", layout.additionalInfo);
           default:
             if (incoming) {
               return ph::lng_wallet_row_from(ph::now);
@@ -674,20 +980,20 @@ class HistoryRow final {
       }());
 
       const auto timeTop = labelTop;
-      const auto timeLeft = x + avail - _layout.time.maxWidth();
+      const auto timeLeft = x + avail - layout.time.maxWidth();
       p.setPen(st::windowSubTextFg);
-      _layout.time.draw(p, timeLeft, timeTop, avail);
-      if (_layout.flags & Flag::Encrypted) {
+      layout.time.draw(p, timeLeft, timeTop, avail);
+      if (layout.flags & Flag::Encrypted) {
         const auto iconLeft = x + avail - st::walletCommentIconLeft - st::walletCommentIcon.width();
         const auto iconTop = labelTop + st::walletCommentIconTop;
         st::walletCommentIcon.paint(p, iconLeft, iconTop, avail);
       }
-      if (_layout.flags & Flag::Pending) {
+      if (layout.flags & Flag::Pending) {
         st::walletRowPending.paint(p, (timeLeft - st::walletRowPendingPosition.x() - st::walletRowPending.width()),
                                    timeTop + st::walletRowPendingPosition.y(), avail);
       }
     }
-    y += std::max(_layout.amountGrams.minHeight(), st::normalFont->height);
+    y += std::max(layout.amountGrams.minHeight(), st::normalFont->height);
 
     if (_button.has_value()) {
       auto &button = *_button;
@@ -697,24 +1003,24 @@ class HistoryRow final {
       button->setVisible(true);
     }
 
-    if (!_layout.address.isEmpty()) {
+    if (!layout.address.isEmpty()) {
       p.setPen(st::windowFg);
       y += st::walletRowAddressTop;
-      _layout.address.drawElided(p, x, y, _layout.addressWidth, _layout.lineCount, style::al_topleft, 0, -1, 0, true);
-      y += _layout.addressHeight;
+      layout.address.drawElided(p, x, y, layout.addressWidth, layout.lineCount, style::al_topleft, 0, -1, 0, true);
+      y += layout.addressHeight;
     }
-    if (!_layout.comment.isEmpty()) {
+    if (!layout.comment.isEmpty()) {
       y += st::walletRowCommentTop;
       if (_decryptionFailed) {
         p.setPen(st::boxTextFgError);
       }
-      _layout.comment.drawElided(p, x, y, avail, kCommentLinesMax);
+      layout.comment.drawElided(p, x, y, avail, kCommentLinesMax);
       y += _commentHeight;
     }
-    if (!_layout.fees.isEmpty()) {
+    if (!layout.fees.isEmpty()) {
       p.setPen(st::windowSubTextFg);
       y += st::walletRowFeesTop;
-      _layout.fees.draw(p, x, y, avail);
+      layout.fees.draw(p, x, y, avail);
     }
   }
   void paintDate(Painter &p, int x, int y) {
@@ -722,7 +1028,7 @@ class HistoryRow final {
       return;
     }
 
-    Expects(!_layout.date.isEmpty());
+    Expects(_showDate && _layout.has_value());
     Expects(_repaintDate != nullptr);
 
     const auto hasShadow = (y != top());
@@ -749,7 +1055,7 @@ class HistoryRow final {
     x += padding.left();
     p.setOpacity(1.);
     p.setPen(st::windowFg);
-    _layout.date.draw(p, x, y + st::walletRowDateTop, avail);
+    _layout->date.draw(p, x, y + st::walletRowDateTop, avail);
   }
 
   [[nodiscard]] bool isUnderCursor(QPoint point) const {
@@ -760,6 +1066,13 @@ class HistoryRow final {
   }
 
  private:
+  enum class LayoutKind {
+    Regular,
+    Token,
+    DePool,
+    Multisig,
+  };
+
   [[nodiscard]] QRect computeInnerRect() const {
     const auto padding = st::walletRowPadding;
     const auto use = std::min(_width, st::walletRowWidthMax);
@@ -767,12 +1080,41 @@ class HistoryRow final {
     const auto left = (use < _width) ? ((_width - use) / 2 + padding.left() - st::walletRowShadowAdd) : 0;
     const auto width = (use < _width) ? (avail + 2 * st::walletRowShadowAdd) : _width;
     auto y = top();
-    if (!_layout.date.isEmpty()) {
+    if (_showDate) {
       y += st::walletRowDateSkip;
     }
     return QRect(left, y, width, bottom() - y);
   }
 
+  void setLayout(LayoutKind kind, const Ton::Symbol &symbol, PrepareLayout prepare) {
+    resetButton();
+    if (_kind != kind) {
+      _kind = kind;
+      _measuredWidth = 0;
+    }
+    _symbol = symbol;
+    _prepare = std::move(prepare);
+    ++_generation;
+    if (_layout.has_value()) {
+      rebuildLayout();
+    }
+  }
+
+  void rebuildLayout() {
+    setLayoutData(_prepare(*_transaction));
+  }
+
+  void setLayoutData(TransactionLayoutData &&data) {
+    _layout = buildLayout(std::move(data));
+    _textsGeneration = TimeShiftGeneration;
+    if (_decryptionFailed) {
+      _layout->comment.setText(st::defaultTextStyle, ph::lng_wallet_decrypt_failed(ph::now), _textPlainOptions);
+    }
+    if (_showDate) {
+      refreshTimeTexts(*_layout, true);
+    }
+  }
+
   void resetButton() {
     if (_button.has_value()) {
       (*_button)->setParent(nullptr);
@@ -781,56 +1123,121 @@ class HistoryRow final {
   }
 
   Ton::Symbol _symbol;
-  TransactionLayout _layout;
-
-  Ton::Transaction _transaction;
+  TransactionPtr _transaction;
+  QString _owner;
+  mutable QDateTime _dateTime;
+  mutable int _dateGeneration = -1;
+  int _textsGeneration = -1;
 
   Fn<void()> _decrypt = [] {};
 
+  LayoutKind _kind = LayoutKind::Regular;
+  PrepareLayout _prepare;
+  std::optional<TransactionLayout> _layout;
+  int _generation = 0;
+  int _requestedGeneration = -1;
+
+  int _index = 0;
+  bool _inPendingList = false;
+  int _listIndex = 0;
+
   int _top = 0;
   int _width = 0;
   int _height = 0;
   int _commentHeight = 0;
+  int _measuredWidth = 0;
+  int _measuredHeight = 0;
 
   Ui::Animations::Simple _dateShadowShown;
   Fn<void()> _repaintDate;
+  bool _showDate = false;
   bool _dateHasShadow = false;
   bool _decryptionFailed = false;
   std::optional<object_ptr<Ui::RoundButton>> _button = std::nullopt;
 };
 
+namespace {
+
+[[nodiscard]] RowPool &HistoryRowPool() {
+  static auto result = RowPool(sizeof(HistoryRow));
+  return result;
+}
+
+[[nodiscard]] uchar ComputeRowFlags(not_null<const HistoryRow *> row) {
+  return (row->isVisible() ? kRowVisibleFlag : uchar()) | (row->showDate() ? kRowShowDateFlag : uchar());
+}
+
+}  // namespace
+
+void *HistoryRow::operator new(std::size_t size) {
+  Expects(size == sizeof(HistoryRow));
+
+  return HistoryRowPool().allocate();
+}
+
+void HistoryRow::operator delete(void *slot) {
+  HistoryRowPool().release(slot);
+}
+
+struct History::PreparedLayout {
+  base::weak_ptr<HistoryRow> row;
+  HistoryRow::LayoutTask task;
+  TransactionLayoutData data;
+};
+
 History::History(not_null<Ui::RpWidget *> parent, rpl::producer<HistoryState> state,
                  rpl::producer<std::pair<HistoryPageKey, Ton::LoadedSlice>> loaded,
                  rpl::producer<not_null<std::vector<Ton::Transaction> *>> collectEncrypted,
                  rpl::producer<not_null<const std::vector<Ton::Transaction> *>> updateDecrypted,
                  rpl::producer<not_null<std::map<QString, QString> *>> updateWalletOwners,
                  rpl::producer<NotificationsHistoryUpdate> updateNotifications,
-                 rpl::producer<std::optional<SelectedAsset>> selectedAsset)
-    : _widget(parent), _selectedAsset(SelectedToken{.symbol = Ton::Symbol::ton()}) {
+                 rpl::producer<std::optional<SelectedAsset>> selectedAsset, HistoryCache *cache)
+    : _widget(parent), _cache(cache), _selectedAsset(SelectedToken{.symbol = Ton::Symbol::ton()}) {
   setupContent(std::move(state), std::move(loaded), std::move(selectedAsset));
 
-  base::unixtime::updates()  //
+  auto phrasesUpdated = PhrasesUpdated()  //
+                        | rpl::before_next([] {
+                            ShortTimeTexts.clear();
+                            ShortDateTexts.clear();
+                          });
+  rpl::merge(base::unixtime::updates(), std::move(phrasesUpdated))  //
       | rpl::start_with_next(
             [=] {
-              for (auto &items : _rows) {
-                for (auto &row : items.second.pending) {
-                  row->refreshDate();
+              ++TimeShiftGeneration;
+              for (auto &[page, rows] : _rows) {
+                rows.datesDirty = true;
+                for (const auto row : rows.timedRows) {
+                  rows.dirty.insert(row);
                 }
-                for (auto &row : items.second.regular) {
-                  row->refreshDate();
+              }
+
+              // Only the texts in the viewport are shaped now, the rest when they scroll into it.
+              const auto it = _rows.find(currentPage());
+              if (it != end(_rows)) {
+                for (const auto row : it->second.materialized) {
+                  const auto top = syncRowTop(it->second, row);
+                  if (top < _visibleBottom && top + row->height() > _visibleTop) {
+                    row->refreshDate();
+                  }
                 }
               }
               refreshShowDates(_selectedAsset.current());
             },
             _widget.lifetime());
 
+  style::PaletteChanged()  //
+      | rpl::start_with_next([] { AddressWidths.clear(); }, _widget.lifetime());
+
   std::move(collectEncrypted)  //
       | rpl::start_with_next(
             [=](not_null<std::vector<Ton::Transaction> *> list) {
               auto it = _transactions.find(kMainPageKey);
               if (it != end(_transactions)) {
-                auto &&encrypted = ranges::views::all(it->second.list) | ranges::views::filter(IsEncryptedMessage);
-                list->insert(list->end(), encrypted.begin(), encrypted.end());
+                for (const auto &transaction : it->second.list) {
+                  if (IsEncryptedMessage(*transaction)) {
+                    list->push_back(*transaction);
+                  }
+                }
               }
             },
             _widget.lifetime());
@@ -845,11 +1252,11 @@ History::History(not_null<Ui::RpWidget *> parent, rpl::producer<HistoryState> st
               auto &transactions = it->second;
 
               auto changed = false;
-              for (auto i = 0, count = static_cast<int>(transactions.list.size()); i != count; ++i) {
-                if (IsEncryptedMessage(transactions.list[i])) {
-                  if (takeDecrypted(i, *list)) {
-                    changed = true;
-                  }
+              for (const auto &decrypted : *list) {
+                const auto index = transactions.indexOf(decrypted.id);
+                if (index >= 0 && IsEncryptedMessage(*transactions.list[index])) {
+                  takeDecrypted(index, decrypted);
+                  changed = true;
                 }
               }
               if (changed) {
@@ -867,10 +1274,30 @@ History::History(not_null<Ui::RpWidget *> parent, rpl::producer<HistoryState> st
 
               auto shouldUpdate = false;
               for (auto &&[wallet, owner] : *owners.get()) {
-                shouldUpdate |=
+                const auto inserted =
                     _tokenOwners
                         .emplace(std::piecewise_construct, std::forward_as_tuple(wallet), std::forward_as_tuple(owner))
                         .second;
+                if (!inserted) {
+                  continue;
+                }
+                shouldUpdate = true;
+                for (auto &[page, rows] : _rows) {
+                  const auto it = rows.unresolvedOwners.find(wallet);
+                  if (it != rows.unresolvedOwners.end()) {
+                    for (const auto row : it->second) {
+                      rows.dirty.insert(row.get());
+                    }
+                    rows.unresolvedOwners.erase(it);
+                  }
+                }
+              }
+              if (shouldUpdate) {
+                // Returned change detection on the main page depends on the known token wallets.
+                const auto it = _rows.find(kMainPageKey);
+                if (it != _rows.end()) {
+                  it->second.allDirty = true;
+                }
               }
 
               const auto selectedAsset = _selectedAsset.current();
@@ -907,36 +1334,142 @@ void History::resizeToWidth(int width) {
   }
   auto &rows = rowsIt->second;
 
-  auto top = (rows.pending.empty() && rows.regular.empty()) ? 0 : st::walletRowsSkip;
-  int height = 0;
+  const auto top = (rows.pending.empty() && rows.regular.empty()) ? 0 : st::walletRowsSkip;
+  const auto height = layoutRows(rows, width);
+  materializeRows(rows);
 
-  auto maxLt = std::numeric_limits<int64>::max();
-  for (auto i = 0, j = 0; i < rows.pending.size() || j < rows.regular.size();) {
-    auto &pending = rows.pending;
-    auto &regular = rows.regular;
+  _widget.resize(width, (height > 0 ? top * 2 : 0) + height);
 
-    HistoryRow *row = nullptr;
+  checkPreload();
+}
 
-    const auto pendingLt = i < pending.size() ? pending[i]->transaction().id.lt : 0;
-    const auto regularLt = j < regular.size() ? regular[j]->transaction().id.lt : 0;
+int History::layoutRows(RowsState &rows, int width) {
+  if (rows.orderChanged) {
+    rebuildOrder(rows);
+  }
 
-    if (pendingLt < maxLt && pendingLt > std::max(regularLt, int64{0})) {
-      row = pending[i++].get();
-    } else if (regularLt < maxLt && regularLt > std::max(pendingLt, int64{0})) {
-      row = regular[j++].get();
+  if (rows.layoutWidth != width || rows.offsets.count() != int(rows.order.size())) {
+    auto heights = std::vector<int>();
+    heights.reserve(rows.order.size());
+    rows.flags.clear();
+    rows.flags.reserve(rows.order.size());
+    for (const auto row : rows.order) {
+      row->resizeToWidth(width);
+      heights.push_back(row->height());
+      rows.flags.push_back(ComputeRowFlags(row));
     }
-
-    if (row != nullptr) {
-      maxLt = row->transaction().id.lt;
-      row->setTop(top + height);
+    rows.offsets.build(std::move(heights));
+    rows.layoutWidth = width;
+  } else {
+    for (const auto row : rows.resized) {
       row->resizeToWidth(width);
-      height += row->height();
+      rows.offsets.set(row->index(), row->height());
+      rows.flags[row->index()] = ComputeRowFlags(row);
     }
   }
+  rows.resized.clear();
+  return rows.offsets.total();
+}
 
-  _widget.resize(width, (height > 0 ? top * 2 : 0) + height);
+int History::syncRowTop(const RowsState &rows, not_null<HistoryRow *> row) {
+  const auto index = row->index();
+  if (index < rows.offsets.count() && index < int(rows.order.size()) && rows.order[index] == row) {
+    row->setTop(st::walletRowsSkip + rows.offsets.top(index));
+  }
+  return row->top();
+}
 
-  checkPreload();
+void History::materializeRows(RowsState &rows) {
+  const auto visibleHeight = _visibleBottom - _visibleTop;
+  if (visibleHeight <= 0 || rows.orderChanged || rows.offsets.count() != int(rows.order.size())) {
+    return;
+  }
+
+  const auto releaseHeight = kReleaseScreens * visibleHeight;
+  rows.materialized.erase(ranges::remove_if(rows.materialized,
+                                            [&](not_null<HistoryRow *> row) {
+                                              const auto top = syncRowTop(rows, row);
+                                              const auto far = !row->isVisible() ||
+                                                               top + row->height() <= _visibleTop - releaseHeight ||
+                                                               top >= _visibleBottom + releaseHeight;
+                                              if (far) {
+                                                row->releaseLayout();
+                                              }
+                                              return far;
+                                            }),
+                          end(rows.materialized));
+
+  const auto preloadHeight = kPreloadScreens * visibleHeight;
+  const auto from = _visibleTop - preloadHeight - st::walletRowsSkip;
+  const auto till = _visibleBottom + preloadHeight - st::walletRowsSkip;
+
+  auto requested = std::vector<not_null<HistoryRow *>>();
+  const auto count = rows.offsets.count();
+  auto index = rows.offsets.findByOffset(from);
+  for (auto top = rows.offsets.top(index); index < count && top < till; top += rows.offsets.height(index++)) {
+    if (!(rows.flags[index] & kRowVisibleFlag)) {
+      continue;
+    }
+    const auto row = rows.order[index];
+    if (row->hasLayout()) {
+      row->refreshDate();
+    } else if (!row->layoutRequested()) {
+      requested.push_back(row);
+    }
+  }
+  prepareLayouts(std::move(requested));
+}
+
+void History::prepareLayouts(std::vector<not_null<HistoryRow *>> &&rows) {
+  if (rows.empty()) {
+    return;
+  }
+  auto batch = std::vector<PreparedLayout>();
+  batch.reserve(rows.size());
+  for (const auto row : rows) {
+    batch.push_back(PreparedLayout{.row = base::make_weak(row.get()), .task = row->requestLayout()});
+  }
+
+  // Only the texts shaping and the geometry are left for the main thread.
+  crl::async([weak = base::make_weak(this), batch = std::move(batch)]() mutable {
+    for (auto &prepared : batch) {
+      prepared.data = prepared.task.prepare(*prepared.task.transaction);
+    }
+    crl::on_main(weak, [=, batch = std::move(batch)]() mutable { weak->commitLayouts(std::move(batch)); });
+  });
+}
+
+void History::commitLayouts(std::vector<PreparedLayout> &&batch) {
+  const auto rowsIt = _rows.find(currentPage());
+
+  auto changed = false;
+  for (auto &prepared : batch) {
+    const auto row = prepared.row.get();
+    if (!row) {
+      continue;
+    }
+    const auto index = row->index();
+    const auto current = (rowsIt != end(_rows)) && !rowsIt->second.orderChanged &&
+                         (index < int(rowsIt->second.order.size())) && (rowsIt->second.order[index] == row);
+    if (!current) {
+      row->cancelLayoutRequest();
+    } else if (row->applyLayout(prepared.task.generation, std::move(prepared.data))) {
+      rowsIt->second.materialized.push_back(row);
+      rowsIt->second.resized.insert(row);
+      changed = true;
+    }
+  }
+  if (changed) {
+    resizeToWidth(_widget.width());
+    _widget.update(0, _visibleTop, _widget.width(), _visibleBottom - _visibleTop);
+  }
+}
+
+void History::forgetRow(RowsState &rows, not_null<HistoryRow *> row) {
+  rows.materialized.erase(ranges::remove(rows.materialized, row), end(rows.materialized));
+  rows.resized.remove(row.get());
+  rows.orderChanged = true;
+  resetDerivedState(rows);
 }
 
 rpl::producer<int> History::heightValue() const {
@@ -947,16 +1480,72 @@ void History::setVisible(bool visible) {
   _widget.setVisible(visible);
 }
 
+void History::setSearchQuery(const QString &query) {
+  const auto trimmed = query.trimmed();
+  if (_searchQuery == trimmed) {
+    return;
+  }
+  const auto previous = std::exchange(_searchQuery, trimmed);
+  const auto narrows = HistorySearchIndex::Narrows(previous, trimmed);
+  const auto current = currentPage();
+  for (auto &[page, transactions] : _transactions) {
+    const auto was = std::exchange(transactions.searchMatches, std::nullopt);
+    const auto rowsIt = _rows.find(page);
+    if (rowsIt == end(_rows)) {
+      continue;
+    }
+    auto &rows = rowsIt->second;
+    if (page != current || !was.has_value() || trimmed.isEmpty()) {
+      rows.allDirty = true;
+      continue;
+    }
+
+    // Only the rows which started or stopped matching are filtered again.
+    transactions.searchMatches = transactions.search.find(trimmed, narrows ? &*was : nullptr);
+    auto changed = std::vector<int64>();
+    std::set_symmetric_difference(begin(*was), end(*was), begin(*transactions.searchMatches),
+                                  end(*transactions.searchMatches), std::back_inserter(changed));
+    for (const auto lt : changed) {
+      const auto i = transactions.positions.find(lt);
+      const auto index = (i != end(transactions.positions)) ? (i->second - transactions.firstPosition) : -1;
+      if (index < 0 || index >= int(rows.regular.size()) || rows.regular[index]->transaction().id.lt != lt) {
+        rows.allDirty = true;
+        break;
+      }
+      rows.dirty.insert(rows.regular[index].get());
+    }
+  }
+  refreshShowDates(_selectedAsset.current());
+}
+
 void History::setVisibleTopBottom(int top, int bottom) {
   auto page = currentPage();
 
+  const auto now = crl::now();
+  const auto scrolled = (top - _widget.y()) - _visibleTop;
+  const auto elapsed = now - _scrollTime;
+  if (elapsed >= kScrollVelocityWindow) {
+    _scrollVelocity = 0.;
+  } else if (elapsed > 0) {
+    // Only scrolling down brings the older slices closer.
+    const auto velocity = std::max(scrolled, 0) / float64(elapsed);
+    _scrollVelocity = (_scrollVelocity + velocity) / 2.;
+  }
+  _scrollTime = now;
+
   _visibleTop = top - _widget.y();
   _visibleBottom = bottom - _widget.y();
+  if (_visibleBottom <= _visibleTop) {
+    return;
+  }
 
-  auto transactionsIt = _transactions.find(page);
   auto rowsIt = _rows.find(page);
-  if (_visibleBottom <= _visibleTop ||
-      (transactionsIt != end(_transactions) && !transactionsIt->second.previousId.lt) ||
+  if (rowsIt != end(_rows)) {
+    materializeRows(rowsIt->second);
+  }
+
+  auto transactionsIt = _transactions.find(page);
+  if ((transactionsIt != end(_transactions) && !transactionsIt->second.previousId.lt) ||
       (rowsIt != end(_rows) && rowsIt->second.regular.empty())) {
     return;
   }
@@ -967,11 +1556,11 @@ rpl::producer<std::pair<HistoryPageKey, Ton::TransactionId>> History::preloadReq
   return _preloadRequests.events();
 }
 
-rpl::producer<Ton::Transaction> History::viewRequests() const {
+rpl::producer<TransactionPtr> History::viewRequests() const {
   return _viewRequests.events();
 }
 
-rpl::producer<Ton::Transaction> History::decryptRequests() const {
+rpl::producer<TransactionPtr> History::decryptRequests() const {
   return _decryptRequests.events();
 }
 
@@ -979,6 +1568,14 @@ rpl::producer<std::pair<const Ton::Symbol *, const QSet<QString> *>> History::ow
   return _ownerResolutionRequests.events();
 }
 
+rpl::producer<HistoryAnalyticsResult> History::analytics(HistoryAnalyticsQuery query) const {
+  return _analytics.query(std::move(query));
+}
+
+rpl::producer<float64> History::ingestionProgress() const {
+  return _ingestionProgress.value();
+}
+
 rpl::producer<not_null<const QString *>> History::dePoolDetailsRequests() const {
   return _dePoolDetailsRequests.events();
 }
@@ -1012,18 +1609,34 @@ void History::setupContent(rpl::producer<HistoryState> &&state,
   std::forward<std::decay_t<decltype(loaded)>>(loaded)  //
       | rpl::start_with_next(
             [=](const std::pair<HistoryPageKey, Ton::LoadedSlice> &slice) {
-              auto it = _transactions.find(slice.first);
-              if (it == end(_transactions)) {
-                it = _transactions
-                         .emplace(std::piecewise_construct, std::forward_as_tuple(slice.first),
-                                  std::forward_as_tuple(TransactionsState{}))
-                         .first;
+              auto &transactions = transactionsState(slice.first);
+              const auto &list = slice.second.data.list;
+
+              const auto requested = (transactions.requestedLt != 0) &&
+                                     (transactions.requestedLt == transactions.previousId.lt);
+              const auto continues = list.empty() ? requested
+                                                  : (transactions.previousId.lt != 0 &&
+                                                     list.front().id.lt == transactions.previousId.lt);
+              if (!continues) {
+                // A duplicate or a slice of the list which was replaced meanwhile.
+                ++_preloadStats.wasted;
+                return;
+              } else if (requested) {
+                const auto latency = crl::now() - transactions.requestedAt;
+                transactions.latency = transactions.latency ? (transactions.latency + latency) / 2 : latency;
               }
-              auto &transactions = it->second;
+              transactions.requestedLt = 0;
 
               transactions.previousId = slice.second.data.previousId;
-              transactions.list.insert(end(transactions.list), slice.second.data.list.begin(),
-                                       slice.second.data.list.end());
+              auto added = ShareTransactions(list.begin(), list.end());
+              if (_cache) {
+                _cache->append(slice.first, added, transactions.previousId);
+              }
+              transactions.list.insert(end(transactions.list), std::make_move_iterator(added.begin()),
+                                       std::make_move_iterator(added.end()));
+              transactions.indexBack(static_cast<int>(list.size()));
+              const auto till = static_cast<int>(transactions.list.size());
+              indexTransactions(slice.first, transactions, till - static_cast<int>(list.size()), till);
               refreshRows(_selectedAsset.current());
             },
             lifetime());
@@ -1036,6 +1649,8 @@ void History::setupContent(rpl::producer<HistoryState> &&state,
             },
             lifetime());
 
+  Ui::TokenIconsUpdated() | rpl::start_with_next([=] { _widget.update(); }, lifetime());
+
   _widget.setAttribute(Qt::WA_MouseTracking);
   _widget.events()  //
       | rpl::start_with_next(
@@ -1073,6 +1688,7 @@ void History::setupContent(rpl::producer<HistoryState> &&state,
                     for (auto &row : it->second.pending) {
                       row->setVisible(false);
                     }
+                    resetDerivedState(it->second);
                   },
                   [&](const SelectedMultisig &selectedMultisig) {
                     const auto it = _rows.find(accountPageKey(selectedMultisig.address));
@@ -1082,10 +1698,28 @@ void History::setupContent(rpl::producer<HistoryState> &&state,
                     for (auto &row : it->second.regular) {
                       row->setVisible(false);
                     }
+                    resetDerivedState(it->second);
                   },
                   [&](auto &&) {});
 
+              const auto previousPage = currentPage();
+              const auto previousRowsIt = _rows.find(previousPage);
+              if (previousRowsIt != _rows.end()) {
+                for (const auto &row : previousRowsIt->second.materialized) {
+                  row->releaseLayout();
+                }
+                previousRowsIt->second.materialized.clear();
+              }
+              const auto previousTransactionsIt = _transactions.find(previousPage);
+              if (previousTransactionsIt != _transactions.end()) {
+                previousTransactionsIt->second.lastViewed = crl::now();
+              }
+
               _selectedAsset = asset.value_or(SelectedToken::defaultToken());
+              if (_evictedRows.remove(currentPage())) {
+                ingestRows();
+              }
+              enforceMemoryBudget();
               refreshShowDates(_selectedAsset.current());
             },
             _widget.lifetime());
@@ -1131,20 +1765,16 @@ void History::selectRowByMouse() {
 
   const auto point = _widget.mapFromGlobal(QCursor::pos());
 
-  const auto searchRow = [&](const std::decay_t<decltype(rows.regular)> &rows, bool pending) -> bool {
-    const auto from = ranges::upper_bound(rows, point.y(), ranges::less(), &HistoryRow::bottom);
-    const auto till = ranges::lower_bound(rows, point.y(), ranges::less(), &HistoryRow::top);
-
-    if (from != rows.end() && from != till && (*from)->isUnderCursor(point)) {
-      selectRow(std::make_pair(pending, from - begin(rows)), (*from)->handlerUnderCursor(point));
-      return true;
+  const auto index = rows.offsets.findByOffset(point.y() - st::walletRowsSkip);
+  if (!rows.orderChanged && index < rows.offsets.count() && index < int(rows.order.size())) {
+    const auto row = rows.order[index];
+    syncRowTop(rows, row);
+    if (row->isUnderCursor(point)) {
+      selectRow(std::make_pair(row->inPendingList(), row->listIndex()), row->handlerUnderCursor(point));
+      return;
     }
-    return false;
-  };
-
-  if (!searchRow(rows.regular, false) && !searchRow(rows.pending, true)) {
-    selectRow(std::make_pair(false, -1), nullptr);
   }
+  selectRow(std::make_pair(false, -1), nullptr);
 }
 
 void History::pressRow() {
@@ -1175,12 +1805,7 @@ void History::releaseRow() {
   if (handler) {
     handler->onClick(ClickContext());
   } else {
-    const auto it = _transactions.find(pending ? kMainPageKey : page);
-    if (it != _transactions.end()) {
-      const auto i = ranges::find(it->second.list, rows[selected]->id(), &Ton::Transaction::id);
-      Assert(i != end(it->second.list));
-      _viewRequests.fire_copy(*i);
-    }
+    _viewRequests.fire(rows[selected]->viewTransaction());
   }
 }
 
@@ -1191,9 +1816,9 @@ void History::decryptById(const Ton::TransactionId &id) {
   }
   const auto &transactions = transactionsIt->second;
 
-  const auto i = ranges::find(transactions.list, id, &Ton::Transaction::id);
-  Assert(i != end(transactions.list));
-  _decryptRequests.fire_copy(*i);
+  const auto index = transactions.indexOf(id);
+  Assert(index >= 0);
+  _decryptRequests.fire_copy(transactions.list[index]);
 }
 
 void History::paint(Painter &p, QRect clip) {
@@ -1201,42 +1826,81 @@ void History::paint(Painter &p, QRect clip) {
   if (rowsIt == _rows.end()) {
     return;
   }
-  const auto &rows = rowsIt->second;
+  auto &state = rowsIt->second;
 
-  if (rows.pending.empty() && rows.regular.empty()) {
+  if (state.order.empty() || state.orderChanged || state.offsets.count() != int(state.order.size())) {
     return;
   }
 
-  const auto paintRows = [&](const std::vector<std::unique_ptr<HistoryRow>> &rows) {
-    const auto from = ranges::upper_bound(rows, clip.top(), ranges::less(), &HistoryRow::bottom);
-    const auto till = ranges::lower_bound(rows, clip.top() + clip.height(), ranges::less(), &HistoryRow::top);
-    if (from == till || from == rows.end()) {
-      return;
+  // Rows are normally requested by setVisibleTopBottom() before they get painted,
+  // the ones which got here earlier than that are painted when their layouts are ready.
+  auto requested = std::vector<not_null<HistoryRow *>>();
+  const auto hasLayout = [&](not_null<HistoryRow *> row) {
+    if (row->hasLayout()) {
+      return true;
+    } else if (!row->layoutRequested()) {
+      requested.push_back(row);
     }
-    for (const auto &row : ranges::make_subrange(from, till)) {
-      row->paint(p, 0, row->top());
+    return false;
+  };
+
+  const auto &offsets = state.offsets;
+  const auto skip = st::walletRowsSkip;
+  const auto count = offsets.count();
+  auto till = offsets.findByOffset(clip.top() - skip);
+  for (auto top = skip + offsets.top(till); till < count && top < clip.top() + clip.height();
+       top += offsets.height(till++)) {
+    if (!(state.flags[till] & kRowVisibleFlag)) {
+      continue;
     }
-    auto lastDateTop = rows.back()->bottom();
-    const auto dates = ranges::make_subrange(begin(rows), till);
-    for (const auto &row : dates | ranges::views::reverse) {
-      if (!row->showDate()) {
-        continue;
-      }
-      const auto top = std::max(std::min(_visibleTop, lastDateTop - st::walletRowDateHeight), row->top());
-      row->paintDate(p, 0, top);
-      if (row->top() <= _visibleTop) {
-        break;
-      }
-      lastDateTop = top;
+    const auto row = state.order[till];
+    if (hasLayout(row)) {
+      row->setTop(top);
+      row->paint(p, 0, top);
     }
-  };
-  paintRows(rows.pending);
-  paintRows(rows.regular);
+  }
+
+  // Walk the date headers up from the bottom of the clip until the one pinned to the top.
+  auto lastDateTop = skip + offsets.total();
+  for (auto it = state.dateHeaders.lower_bound(till); it != state.dateHeaders.begin();) {
+    const auto index = *--it;
+    if ((state.flags[index] & (kRowVisibleFlag | kRowShowDateFlag)) != (kRowVisibleFlag | kRowShowDateFlag)) {
+      continue;
+    }
+    const auto row = state.order[index];
+    const auto top = skip + offsets.top(index);
+    const auto dateTop = std::max(std::min(_visibleTop, lastDateTop - st::walletRowDateHeight), top);
+    if (hasLayout(row)) {
+      row->setTop(top);
+      row->paintDate(p, 0, dateTop);
+    }
+    if (top <= _visibleTop) {
+      break;
+    }
+    lastDateTop = dateTop;
+  }
+
+  prepareLayouts(std::move(requested));
 }
 
 void History::mergeState(HistoryState &&state) {
-  _knownContracts = std::move(state.knownContracts);
-  _multisigTimeouts = std::move(state.multisigTimeouts);
+  if (_knownContracts != state.knownContracts) {
+    _knownContracts = std::move(state.knownContracts);
+    const auto it = _rows.find(kMainPageKey);
+    if (it != _rows.end()) {
+      it->second.allDirty = true;
+    }
+  }
+  if (_multisigTimeouts != state.multisigTimeouts) {
+    for (const auto &[address, timeout] : state.multisigTimeouts) {
+      const auto was = _multisigTimeouts.find(address);
+      const auto it = _rows.find(accountPageKey(address));
+      if (it != _rows.end() && (was == _multisigTimeouts.end() || was->second != timeout)) {
+        it->second.allDirty = true;
+      }
+    }
+    _multisigTimeouts = std::move(state.multisigTimeouts);
+  }
   mergePending(std::move(state.pendingTransactions));
   //refreshPending();
   if (mergeListChanged(std::move(state.lastTransactions))) {
@@ -1269,7 +1933,10 @@ void History::mergeNotifications(NotificationsHistoryUpdate &&update) {
         while (latestIt != rows.end() && notification.transaction.id.lt < (*latestIt)->transaction().id.lt) {
           ++latestIt;
         }
-        it->second.pending.insert(latestIt, makeRow(notification.transaction));
+        auto transaction = std::make_shared<const Ton::Transaction>(std::move(notification.transaction));
+        const auto row = it->second.pending.insert(latestIt, makeRow(std::move(transaction)))->get();
+        it->second.dirty.insert(row);
+        it->second.orderChanged = true;
 
         const auto asset = SelectedToken{.symbol = notification.symbol};
         if (newSymbol) {
@@ -1289,44 +1956,89 @@ void History::mergeNotifications(NotificationsHistoryUpdate &&update) {
         using Item = std::decay_t<decltype(rows.front())>;
         rows.erase(  //
             ranges::remove_if(rows,
-                              [&](const Item &item) { return item->transaction().id == notification.transactionId; }),
+                              [&](const Item &item) {
+                                if (item->transaction().id == notification.transactionId) {
+                                  forgetRow(it->second, item.get());
+                                  return true;
+                                }
+                                return false;
+                              }),
             end(rows));
       },
-      [&](RefreshNotifications &) { refreshShowDates(_selectedAsset.current()); });
+      [&](RefreshNotifications &) {
+        const auto it = _rows.find(currentPage());
+        if (it == _rows.end()) {
+          return;
+        }
+        for (const auto &row : it->second.pending) {
+          it->second.dirty.insert(row.get());
+        }
+        refreshShowDates(_selectedAsset.current());
+      });
 }
 
 bool History::mergeListChanged(std::map<HistoryPageKey, Ton::TransactionsSlice> &&data) {
   auto changed = false;
   for (auto &[page, newTransactions] : data) {
-    auto transactionsIt = _transactions.find(page);
-    if (transactionsIt == end(_transactions)) {
-      transactionsIt = _transactions
-                           .emplace(std::piecewise_construct, std::forward_as_tuple(std::move(page)),
-                                    std::forward_as_tuple(TransactionsState{}))
-                           .first;
+    auto &transactions = transactionsState(page);
+    if (newTransactions.list.empty() || transactions.indexOf(newTransactions.list.front().id) >= 0) {
+      // Nothing new, or a stale slice of what is already stored.
+      continue;
     }
-    auto &transactions = transactionsIt->second;
 
     const auto i = transactions.list.empty()  //
                        ? newTransactions.list.cend()
-                       : ranges::find(std::as_const(newTransactions.list), transactions.list.front());
+                       : ranges::find(std::as_const(newTransactions.list), transactions.list.front()->id, &Ton::Transaction::id);
     if (i == newTransactions.list.cend()) {
-      transactions.list = newTransactions.list | ranges::to_vector;
+      transactions.list = ShareTransactions(newTransactions.list.cbegin(), newTransactions.list.cend());
       transactions.previousId = std::move(newTransactions.previousId);
+      transactions.requestedLt = 0;
+      transactions.latestCount = static_cast<int>(transactions.list.size());
+      transactions.reindex();
+      transactions.search.clear();
+      transactions.evictedToCache = false;
+      transactions.analyticsComplete = false;
+      _analytics.reset(page);
+      indexTransactions(page, transactions, 0, static_cast<int>(transactions.list.size()));
+      if (_cache) {
+        _cache->reset(page, transactions.list, transactions.previousId);
+      }
       changed = true;
     } else if (i != newTransactions.list.cbegin()) {
-      transactions.list.insert(begin(transactions.list), newTransactions.list.cbegin(), i);
+      auto added = ShareTransactions(newTransactions.list.cbegin(), i);
+      if (_cache) {
+        _cache->prepend(page, added);
+      }
+      transactions.list.insert(begin(transactions.list), std::make_move_iterator(added.begin()),
+                               std::make_move_iterator(added.end()));
+      transactions.indexFront(static_cast<int>(i - newTransactions.list.cbegin()));
+      transactions.latestCount += static_cast<int>(i - newTransactions.list.cbegin());
+      indexTransactions(page, transactions, 0, static_cast<int>(i - newTransactions.list.cbegin()));
       changed = true;
     }
   }
   return changed;
 }
 
-void History::setRowShowDate(not_null<HistoryRow *> row, bool show) {
+void History::setRowShowDate(RowsState &rows, not_null<HistoryRow *> row, bool show) {
   row->setShowDate(show, [=] { repaintShadow(row); });
+  rows.resized.insert(row.get());
+  if (rows.orderChanged) {
+    return;
+  } else if (show) {
+    rows.dateHeaders.insert(row->index());
+  } else {
+    rows.dateHeaders.remove(row->index());
+  }
+}
+
+QDate History::previousDate(const RowsState &rows, int index) const {
+  // Visible rows between two date headers share the date of the first one.
+  auto it = rows.dateHeaders.lower_bound(index);
+  return (it != rows.dateHeaders.begin()) ? rows.order[*--it]->date().date() : QDate();
 }
 
-bool History::takeDecrypted(int index, const std::vector<Ton::Transaction> &decrypted) {
+void History::takeDecrypted(int index, const Ton::Transaction &decrypted) {
   auto rowsIt = _rows.find(kMainPageKey);
   auto transactionsIt = _transactions.find(kMainPageKey);
   Expects(rowsIt != _rows.end() && transactionsIt != _transactions.end());
@@ -1334,30 +2046,36 @@ bool History::takeDecrypted(int index, const std::vector<Ton::Transaction> &decr
   auto &transactions = transactionsIt->second;
 
   Expects(index >= 0 && index < transactions.list.size());
-  Expects(index >= 0 && index < rows.regular.size());
-  Expects(rows.regular[index]->id() == transactions.list[index].id);
+  Expects(decrypted.id == transactions.list[index]->id);
 
-  const auto i = ranges::find(decrypted, transactions.list[index].id, &Ton::Transaction::id);
-  if (i == end(decrypted)) {
-    return false;
+  if (index >= rows.regular.size()) {
+    // Not ingested yet, the row will be created from the updated list.
+    if (!IsEncryptedMessage(decrypted)) {
+      transactions.list[index] = std::make_shared<const Ton::Transaction>(decrypted);
+      indexTransactions(kMainPageKey, transactions, index, index + 1);
+    }
+    return;
   }
-  if (IsEncryptedMessage(*i)) {
+  Expects(rows.regular[index]->id() == transactions.list[index]->id);
+
+  if (IsEncryptedMessage(decrypted)) {
     rows.regular[index]->setDecryptionFailed();
   } else {
-    transactions.list[index] = *i;
-    rows.regular[index] = makeRow(*i);
+    transactions.list[index] = std::make_shared<const Ton::Transaction>(decrypted);
+    rows.regular[index]->replaceTransaction(transactions.list[index]);
+    indexTransactions(kMainPageKey, transactions, index, index + 1);
   }
-  return true;
+  rows.dirty.insert(rows.regular[index].get());
 }
 
-std::unique_ptr<HistoryRow> History::makeRow(const Ton::Transaction &data) {
-  const auto id = data.id;
+std::unique_ptr<HistoryRow> History::makeRow(TransactionPtr data) {
+  const auto id = data->id;
   if (id.lt == 0) {
     // pending
-    return std::make_unique<HistoryRow>(data);
+    return std::make_unique<HistoryRow>(std::move(data));
   }
 
-  return std::make_unique<HistoryRow>(data, [=] { decryptById(id); });
+  return std::make_unique<HistoryRow>(std::move(data), [=] { decryptById(id); });
 }
 
 void History::refreshShowDates(const SelectedAsset &selectedAsset) {
@@ -1376,11 +2094,32 @@ void History::refreshShowDates(const SelectedAsset &selectedAsset) {
   const auto transactionsIt = _transactions.find(page);
   auto *transactions = transactionsIt != end(_transactions) ? &transactionsIt->second : nullptr;
 
+  if (rows.orderChanged) {
+    rebuildOrder(rows);
+  }
+
+  const auto full = rows.allDirty || !rows.appliedAsset.has_value() || !(*rows.appliedAsset == selectedAsset);
+  if (full) {
+    resetDerivedState(rows);
+    rows.appliedAsset = selectedAsset;
+    rows.allDirty = false;
+  }
+
+  const auto byIndex = [](not_null<HistoryRow *> row) { return row->index(); };
+  auto dirty = std::vector<not_null<HistoryRow *>>();
+  if (full) {
+    dirty = rows.order;
+  } else if (!rows.dirty.empty()) {
+    dirty.reserve(rows.dirty.size());
+    for (const auto row : rows.dirty) {
+      dirty.push_back(row);
+    }
+    ranges::sort(dirty, ranges::less(), byIndex);
+  }
+  rows.dirty.clear();
+
   QSet<QString> unknownOwners;
 
-  std::map<QString, Ton::EthEventStatus> latestEthStatuses;
-  std::map<QString, Ton::TonEventStatus> latestTonStatuses;
-  base::flat_set<int64> executedTransactions;
   int64 expirationTime = 0;
   if (page.first.isTon() && !page.second.isEmpty()) {
     const auto it = _multisigTimeouts.find(page.second);
@@ -1389,15 +2128,66 @@ void History::refreshShowDates(const SelectedAsset &selectedAsset) {
     }
   }
 
+  const auto tonFilter = v::match(
+      selectedAsset, [](const SelectedToken &selectedToken) { return selectedToken.symbol.isTon(); },
+      [](auto &&) { return false; });
+  const auto multisigFilter = v::is<SelectedMultisig>(selectedAsset);
+
+  // Update the derived state with the dirty rows first, so that the rows
+  // which lose their "latest event" or "not executed" status are refiltered too.
+  auto invalidated = std::vector<not_null<HistoryRow *>>();
+  const auto updateLatest = [&](std::map<QString, not_null<HistoryRow *>> &latest, not_null<HistoryRow *> row) {
+    const auto &source = row->transaction().incoming.source;
+    const auto it = latest.find(source);
+    if (it == latest.end()) {
+      latest.emplace(source, row);
+    } else if (row->index() < it->second->index()) {
+      invalidated.push_back(it->second);
+      it->second = row;
+    }
+  };
+  for (const auto row : dirty) {
+    const auto &transaction = row->transaction();
+    if (tonFilter || row->inPendingList()) {
+      v::match(
+          transaction.additional,
+          [&](const Ton::EthEventStatusChanged &) { updateLatest(rows.latestEthStatuses, row); },
+          [&](const Ton::TonEventStatusChanged &) { updateLatest(rows.latestTonStatuses, row); },
+          [](auto &&) {});
+    } else if (multisigFilter) {
+      v::match(
+          transaction.additional,
+          [&](const Ton::MultisigConfirmTransaction &confirmTransaction) {
+            if (!confirmTransaction.executed ||
+                !rows.executedTransactions.emplace(confirmTransaction.transactionId).second) {
+              return;
+            }
+            const auto it = rows.pendingSubmits.find(confirmTransaction.transactionId);
+            if (it != rows.pendingSubmits.end()) {
+              invalidated.insert(end(invalidated), begin(it->second), end(it->second));
+              rows.pendingSubmits.erase(it);
+            }
+          },
+          [](auto &&) {});
+    }
+  }
+  if (!invalidated.empty()) {
+    dirty.insert(end(dirty), begin(invalidated), end(invalidated));
+    ranges::sort(dirty, ranges::less(), byIndex);
+    dirty.erase(ranges::unique(dirty), end(dirty));
+  }
+
   auto filterTransaction = [&, targetAddress = targetAddress, pageAddress = page.second](
                                const SelectedAsset &selectedAsset, bool briefNotifications,
                                not_null<HistoryRow *> row) {
-    auto &transaction = row->transaction();
+    const auto &transaction = row->transaction();
 
     const auto isUnprocessed = transactions == nullptr ||  //
                                transaction.id.lt < transactions->leastScannedTransactionLt ||
                                transaction.id.lt > transactions->latestScannedTransactionLt;
 
+    rows.timedRows.remove(row.get());
+
     v::match(
         selectedAsset,
         [&](const SelectedToken &selectedToken) {
@@ -1406,13 +2196,9 @@ void History::refreshShowDates(const SelectedAsset &selectedAsset) {
             return v::match(
                 transaction.additional,
                 [&](const Ton::EthEventStatusChanged &event) {
-                  auto showButton = event.status == Ton::EthEventStatus::Confirmed;
-                  const auto it = latestEthStatuses.find(transaction.incoming.source);
-                  if (it != latestEthStatuses.end()) {
-                    showButton = false;
-                  } else {
-                    latestEthStatuses.insert(std::make_pair(transaction.incoming.source, event.status));
-                  }
+                  const auto it = rows.latestEthStatuses.find(transaction.incoming.source);
+                  const auto showButton = (event.status == Ton::EthEventStatus::Confirmed) &&
+                                          (it != rows.latestEthStatuses.end()) && (it->second == row);
 
                   const auto &address = transaction.incoming.source;
                   row->setNotificationLayout(
@@ -1420,17 +2206,16 @@ void History::refreshShowDates(const SelectedAsset &selectedAsset) {
                       showButton ? [=] { _collectTokenRequests.fire(&address); } : Fn<void()>{nullptr});
                 },
                 [&](const Ton::TonEventStatusChanged &event) {
-                  auto showButton = event.status == Ton::TonEventStatus::Confirmed;
-                  const auto it = latestTonStatuses.find(transaction.incoming.source);
-                  if (it != latestTonStatuses.end()) {
-                    showButton = false;
-                  } else {
-                    latestTonStatuses.insert(std::make_pair(transaction.incoming.source, event.status));
-                  }
-
-                  if (showButton &&
-                      (base::unixtime::now() - static_cast<TimeId>(transaction.time) > kExecuteVisibleTimeout)) {
-                    showButton = false;
+                  const auto it = rows.latestTonStatuses.find(transaction.incoming.source);
+                  auto showButton = (event.status == Ton::TonEventStatus::Confirmed) &&
+                                    (it != rows.latestTonStatuses.end()) && (it->second == row);
+
+                  if (showButton) {
+                    if (base::unixtime::now() - static_cast<TimeId>(transaction.time) > kExecuteVisibleTimeout) {
+                      showButton = false;
+                    } else {
+                      rows.timedRows.insert(row.get());
+                    }
                   }
 
                   const auto &address = transaction.incoming.source;
@@ -1446,23 +2231,30 @@ void History::refreshShowDates(const SelectedAsset &selectedAsset) {
                   row->setRegularLayout(RegularTransactionParams{.asReturnedChange = asReturnedChange});
                 });
           } else {
+            // Transactions are shared and immutable, the resolved owner is kept by the row layout.
+            auto owner = QString();
             v::match(
                 transaction.additional,
-                [&](Ton::TokenTransfer &tokenTransfer) {
+                [&](const Ton::TokenTransfer &tokenTransfer) {
                   if (!tokenTransfer.direct) {
                     return;
                   }
                   const auto it = _tokenOwners.find(tokenTransfer.address);
                   if (it != _tokenOwners.end()) {
-                    tokenTransfer.address = it->second;
-                    tokenTransfer.direct = false;
-                  } else if (isUnprocessed) {
+                    owner = it->second;
+                    return;
+                  }
+                  auto &waiting = rows.unresolvedOwners[tokenTransfer.address];
+                  if (ranges::find(waiting, row) == end(waiting)) {
+                    waiting.push_back(row);
+                  }
+                  if (isUnprocessed) {
                     unknownOwners.insert(tokenTransfer.address);
                   }
                 },
                 [&](auto &&) {});
             if (!transaction.aborted) {
-              row->setTokenTransactionLayout(selectedToken.symbol);
+              row->setTokenTransactionLayout(selectedToken.symbol, owner);
             } else {
               row->setVisible(false);
             }
@@ -1497,12 +2289,21 @@ void History::refreshShowDates(const SelectedAsset &selectedAsset) {
                 auto showButton = !submitTransaction.executed;
                 SubmitTransactionStatus status;
                 if (showButton) {
-                  const auto executed = executedTransactions.contains(submitTransaction.transactionId);
+                  const auto executed = rows.executedTransactions.contains(submitTransaction.transactionId);
                   const auto expired = (transaction.time + expirationTime) < base::unixtime::now();
                   status = executed  ? SubmitTransactionStatus::Executed
                            : expired ? SubmitTransactionStatus::Expired
                                      : SubmitTransactionStatus::Pending;
                   showButton = !executed && !expired;
+                  if (!executed) {
+                    auto &waiting = rows.pendingSubmits[submitTransaction.transactionId];
+                    if (ranges::find(waiting, row) == end(waiting)) {
+                      waiting.push_back(row);
+                    }
+                  }
+                  if (showButton) {
+                    rows.timedRows.insert(row.get());
+                  }
                 } else {
                   status = SubmitTransactionStatus::Executed;
                 }
@@ -1513,41 +2314,62 @@ void History::refreshShowDates(const SelectedAsset &selectedAsset) {
                   }
                 } : Fn<void()>{nullptr});
               },
-              [&](const Ton::MultisigConfirmTransaction &confirmTransaction) {
-                if (confirmTransaction.executed) {
-                  executedTransactions.emplace(confirmTransaction.transactionId);
-                }
-                row->setMultisigLayout();
-              },
               [&](auto &&) { row->setMultisigLayout(); });
         });
   };
 
-  auto previous = QDate();
-
-  auto maxLt = std::numeric_limits<int64>::max();
-  for (auto i = 0, j = 0; i < rows.pending.size() || j < rows.regular.size();) {
-    auto &pending = rows.pending;
-    auto &regular = rows.regular;
-
-    HistoryRow *row = nullptr;
-    const auto pendingLt = i < pending.size() ? pending[i]->transaction().id.lt : 0;
-    const auto regularLt = j < regular.size() ? regular[j]->transaction().id.lt : 0;
-
-    if (pendingLt < maxLt && pendingLt > std::max(regularLt, int64{0})) {
-      row = pending[i++].get();
+  for (const auto row : dirty) {
+    if (row->inPendingList()) {
       filterTransaction(SelectedToken{.symbol = Ton::Symbol::ton()}, true, row);
-    } else if (regularLt < maxLt && regularLt > std::max(pendingLt, int64{0})) {
-      row = regular[j++].get();
+    } else {
       filterTransaction(selectedAsset, false, row);
     }
+  }
+  if (const auto matches = searchMatches(page)) {
+    for (const auto row : dirty) {
+      if (row->isVisible() && !ranges::binary_search(*matches, row->transaction().id.lt)) {
+        row->setVisible(false);
+      }
+    }
+  }
+  if (full) {
+    rows.layoutWidth = 0;
+  } else {
+    for (const auto row : dirty) {
+      rows.resized.insert(row.get());
+    }
+  }
 
-    if (row != nullptr) {
-      maxLt = row->transaction().id.lt;
-      const auto current = row->date().date();
-      setRowShowDate(row, row->isVisible() && current != previous);
+  const auto applyShowDate = [&](not_null<HistoryRow *> row, const QDate &previous) {
+    const auto show = row->isVisible() && row->date().date() != previous;
+    if (show != row->showDate()) {
+      setRowShowDate(rows, row, show);
+    }
+  };
+  if (full || rows.datesDirty) {
+    auto previous = QDate();
+    for (const auto row : rows.order) {
+      applyShowDate(row, previous);
+      if (row->isVisible()) {
+        previous = row->date().date();
+      }
+    }
+    rows.datesDirty = false;
+  } else {
+    // Visibility of a row affects only its own date header and the one of the next visible row.
+    const auto count = static_cast<int>(rows.order.size());
+    for (const auto row : dirty) {
+      const auto index = row->index();
+      auto previous = previousDate(rows, index);
+      applyShowDate(row, previous);
       if (row->isVisible()) {
-        previous = current;
+        previous = row->date().date();
+      }
+      for (auto i = index + 1; i < count; ++i) {
+        if (rows.order[i]->isVisible()) {
+          applyShowDate(rows.order[i], previous);
+          break;
+        }
       }
     }
   }
@@ -1566,6 +2388,244 @@ void History::refreshShowDates(const SelectedAsset &selectedAsset) {
   _widget.update(0, _visibleTop, _widget.width(), _visibleBottom - _visibleTop);
 }
 
+History::RowsState &History::rowsState(const HistoryPageKey &page) {
+  auto it = _rows.find(page);
+  if (it == end(_rows)) {
+    it = _rows.emplace(page, RowsState{}).first;
+  }
+  return it->second;
+}
+
+History::TransactionsState &History::transactionsState(const HistoryPageKey &page) {
+  auto it = _transactions.find(page);
+  if (it != end(_transactions)) {
+    return it->second;
+  }
+  it = _transactions.emplace(page, TransactionsState{}).first;
+
+  // Start with the cached page, the network slices are merged on top of it.
+  if (_cache) {
+    _cache->load(page, crl::guard(this, [=](std::optional<Ton::TransactionsSlice> cached) {
+      if (cached) {
+        applyCached(page, std::move(*cached), true);
+      }
+    }));
+  }
+  return it->second;
+}
+
+bool History::applyCached(const HistoryPageKey &page, Ton::TransactionsSlice &&cached, bool writeBack) {
+  const auto it = _transactions.find(page);
+  if (it == end(_transactions) || cached.list.empty()) {
+    return false;
+  }
+  auto &transactions = it->second;
+
+  // The network could answer first, then the cache may only continue its list.
+  auto from = cached.list.cbegin();
+  if (!transactions.list.empty()) {
+    const auto last = ranges::find(std::as_const(cached.list), transactions.list.back()->id, &Ton::Transaction::id);
+    if (last == cached.list.cend() || last + 1 == cached.list.cend() || (last + 1)->id.lt != transactions.previousId.lt) {
+      return false;
+    }
+    from = last + 1;
+  }
+  const auto wasEmpty = transactions.list.empty();
+  const auto count = static_cast<int>(cached.list.cend() - from);
+  auto added = ShareTransactions(from, cached.list.cend());
+  if (writeBack && !wasEmpty && _cache) {
+    // The page file was reset to the network slice, keep the older records in it.
+    _cache->append(page, added, cached.previousId);
+  }
+  transactions.list.insert(end(transactions.list), std::make_move_iterator(added.begin()),
+                           std::make_move_iterator(added.end()));
+  transactions.previousId = std::move(cached.previousId);
+  transactions.requestedLt = 0;
+  if (wasEmpty) {
+    transactions.reindex();
+  } else {
+    transactions.indexBack(count);
+  }
+  const auto till = static_cast<int>(transactions.list.size());
+  indexTransactions(page, transactions, till - count, till);
+  refreshRows(_selectedAsset.current());
+  return true;
+}
+
+void History::indexTransactions(const HistoryPageKey &page, TransactionsState &transactions, int from, int till) {
+  Expects(from >= 0 && from <= till && till <= transactions.list.size());
+
+  for (auto i = from; i != till; ++i) {
+    transactions.search.add(*transactions.list[i], page.first);
+  }
+  transactions.searchMatches = std::nullopt;
+
+  _analytics.add(page, transactions.list, from, till);
+  transactions.analyticsComplete = transactions.analyticsComplete || !transactions.previousId.lt;
+  _analytics.setComplete(page, transactions.analyticsComplete);
+}
+
+const std::vector<int64> *History::searchMatches(const HistoryPageKey &page) {
+  if (_searchQuery.isEmpty()) {
+    return nullptr;
+  }
+  static const auto kNoMatches = std::vector<int64>();
+  const auto it = _transactions.find(page);
+  if (it == end(_transactions)) {
+    return &kNoMatches;
+  }
+  auto &transactions = it->second;
+  if (!transactions.searchMatches.has_value()) {
+    transactions.searchMatches = transactions.search.find(_searchQuery);
+  }
+  return &*transactions.searchMatches;
+}
+
+void History::TransactionsState::reindex() {
+  positions.clear();
+  positions.reserve(list.size());
+  firstPosition = 0;
+  for (auto i = 0, count = static_cast<int>(list.size()); i != count; ++i) {
+    positions[list[i]->id.lt] = i;
+  }
+}
+
+void History::TransactionsState::indexFront(int count) {
+  Expects(count >= 0 && count <= list.size());
+
+  firstPosition -= count;
+  for (auto i = 0; i != count; ++i) {
+    positions[list[i]->id.lt] = firstPosition + i;
+  }
+}
+
+void History::TransactionsState::indexBack(int count) {
+  Expects(count >= 0 && count <= list.size());
+
+  const auto from = static_cast<int>(list.size()) - count;
+  for (auto i = from, till = from + count; i != till; ++i) {
+    positions[list[i]->id.lt] = firstPosition + i;
+  }
+}
+
+int History::TransactionsState::indexOf(const Ton::TransactionId &id) const {
+  const auto it = positions.find(id.lt);
+  if (it == positions.end()) {
+    return -1;
+  }
+  const auto index = it->second - firstPosition;
+  return (index >= 0 && index < list.size() && list[index]->id == id) ? index : -1;
+}
+
+void History::RowOffsets::build(std::vector<int> &&heights) {
+  _heights = std::move(heights);
+
+  const auto count = static_cast<int>(_heights.size());
+  _tree.assign(count + 1, 0);
+  _total = 0;
+  for (auto i = 1; i <= count; ++i) {
+    _tree[i] += _heights[i - 1];
+    _total += _heights[i - 1];
+    const auto parent = i + (i & -i);
+    if (parent <= count) {
+      _tree[parent] += _tree[i];
+    }
+  }
+  _highBit = 1;
+  while (_highBit * 2 <= count) {
+    _highBit *= 2;
+  }
+}
+
+void History::RowOffsets::set(int index, int height) {
+  Expects(index >= 0 && index < count());
+
+  const auto delta = height - std::exchange(_heights[index], height);
+  if (!delta) {
+    return;
+  }
+  _total += delta;
+  for (auto i = index + 1; i <= count(); i += (i & -i)) {
+    _tree[i] += delta;
+  }
+}
+
+int History::RowOffsets::count() const {
+  return static_cast<int>(_heights.size());
+}
+
+int History::RowOffsets::total() const {
+  return _total;
+}
+
+int History::RowOffsets::top(int index) const {
+  Expects(index >= 0 && index <= count());
+
+  auto result = 0;
+  for (auto i = index; i > 0; i -= (i & -i)) {
+    result += _tree[i];
+  }
+  return result;
+}
+
+int History::RowOffsets::height(int index) const {
+  Expects(index >= 0 && index < count());
+
+  return _heights[index];
+}
+
+int History::RowOffsets::findByOffset(int offset) const {
+  // Largest index with top(index) <= offset, so that hidden rows are skipped.
+  auto index = 0;
+  for (auto step = _highBit; step > 0; step /= 2) {
+    const auto next = index + step;
+    if (next <= count() && _tree[next] <= offset) {
+      index = next;
+      offset -= _tree[next];
+    }
+  }
+  return index;
+}
+
+void History::rebuildOrder(RowsState &rows) {
+  const auto key = [](const std::unique_ptr<HistoryRow> &row) {
+    const auto lt = row->transaction().id.lt;
+    return lt ? lt : std::numeric_limits<int64>::max();
+  };
+
+  rows.order.clear();
+  rows.order.reserve(rows.pending.size() + rows.regular.size());
+
+  auto i = begin(rows.pending);
+  auto j = begin(rows.regular);
+  while (i != end(rows.pending) || j != end(rows.regular)) {
+    const auto takePending = (j == end(rows.regular)) || (i != end(rows.pending) && key(*i) > key(*j));
+    const auto listIndex = takePending ? (i - begin(rows.pending)) : (j - begin(rows.regular));
+    const auto &row = takePending ? *i++ : *j++;
+    row->setPosition(static_cast<int>(rows.order.size()), takePending, static_cast<int>(listIndex));
+    rows.order.push_back(row.get());
+  }
+  rows.dateHeaders.clear();
+  for (const auto row : rows.order) {
+    if (row->showDate()) {
+      rows.dateHeaders.insert(row->index());
+    }
+  }
+  rows.orderChanged = false;
+  rows.layoutWidth = 0;
+}
+
+void History::resetDerivedState(RowsState &rows) {
+  rows.allDirty = true;
+  rows.dirty.clear();
+  rows.latestEthStatuses.clear();
+  rows.latestTonStatuses.clear();
+  rows.executedTransactions.clear();
+  rows.pendingSubmits.clear();
+  rows.unresolvedOwners.clear();
+  rows.timedRows.clear();
+}
+
 void History::refreshPending() {
   const auto page = currentPage();
   if (page != kMainPageKey) {
@@ -1579,129 +2639,290 @@ void History::refreshPending() {
   auto &pendingRows = it->second.pending;
 
   if (_pendingDataChanged) {
-    pendingRows =                                                                                            //
-        ranges::views::all(_pendingData)                                                                     //
-        | ranges::views::transform([&](const Ton::PendingTransaction &data) { return makeRow(data.fake); })  //
-        | ranges::to_vector;
+    for (const auto &row : pendingRows) {
+      forgetRow(it->second, row.get());
+    }
+    pendingRows = ranges::views::all(_pendingData)  //
+                  | ranges::views::transform([&](const Ton::PendingTransaction &data) {
+                      return makeRow(std::make_shared<const Ton::Transaction>(data.fake));
+                    })  //
+                  | ranges::to_vector;
   }
 
   if (!pendingRows.empty()) {
     auto pendingRow = pendingRows.front().get();
     if (pendingRow->isVisible()) {
-      setRowShowDate(pendingRow);
+      setRowShowDate(it->second, pendingRow);
     }
   }
   resizeToWidth(_widget.width());
 }
 
 void History::refreshRows(const SelectedAsset &selectedAsset) {
-  using RowItem = std::decay_t<decltype(_rows.begin()->second.regular.front())>;
-
-  auto mergeTransactions = [&](std::vector<std::unique_ptr<HistoryRow>> &rows,
-                               const std::vector<Ton::Transaction> &transactions,
-                               const Fn<RowItem(const Ton::Transaction &)> &makeRow) {
-    auto addedFront = std::vector<std::unique_ptr<HistoryRow>>();
-    auto addedBack = std::vector<std::unique_ptr<HistoryRow>>();
-    for (const auto &element : transactions) {
-      if (!rows.empty() && element.id == rows.front()->id()) {
-        break;
+  for (const auto &[page, transactions] : _transactions) {
+    auto &state = rowsState(page);
+    auto &rows = state.regular;
+    if (rows.empty()) {
+      continue;
+    }
+
+    // Regular rows mirror the beginning of the transactions list. Newer transactions
+    // are merged right away, the older ones are left for ingestRows().
+    const auto front = transactions.indexOf(rows.front()->id());
+    if (front < 0) {
+      for (const auto &row : rows) {
+        forgetRow(state, row.get());
       }
-      addedFront.push_back(makeRow(element));
-    }
-    if (!rows.empty()) {
-      const auto from = ranges::find(transactions, rows.back()->id(), &Ton::Transaction::id);
-      if (from != end(transactions)) {
-        addedBack = ranges::make_subrange(from + 1, end(transactions))                                       //
-                    | ranges::views::transform([&](const Ton::Transaction &data) { return makeRow(data); })  //
-                    | ranges::to_vector;
+      rows.clear();
+    } else if (front > 0) {
+      auto added = std::vector<std::unique_ptr<HistoryRow>>();
+      added.reserve(front + rows.size());
+      for (auto i = 0; i != front; ++i) {
+        added.push_back(makePageRow(page, transactions.list[i]));
+        state.dirty.insert(added.back().get());
       }
+      added.insert(end(added), std::make_move_iterator(begin(rows)), std::make_move_iterator(end(rows)));
+      rows = std::move(added);
+      state.orderChanged = true;
     }
-    if (addedFront.empty() && addedBack.empty()) {
+  }
+
+  ingestRows();
+  enforceMemoryBudget();
+  refreshShowDates(selectedAsset);
+}
+
+void History::ingestRows() {
+  const auto started = crl::now();
+  auto ready = 0;
+  auto total = 0;
+  const auto ingest = [&](const HistoryPageKey &page, const TransactionsState &transactions) {
+    if (_evictedRows.contains(page)) {
       return;
-    } else if (!addedFront.empty()) {
-      if (addedFront.size() < transactions.size()) {
-        addedFront.insert(end(addedFront), std::make_move_iterator(begin(rows)), std::make_move_iterator(end(rows)));
+    }
+    auto &state = rowsState(page);
+    auto &rows = state.regular;
+    const auto count = static_cast<int>(transactions.list.size());
+    while (int(rows.size()) < count && crl::now() - started < kIngestionBudget) {
+      const auto till = std::min(count, int(rows.size()) + kIngestionChunk);
+      for (auto i = int(rows.size()); i != till; ++i) {
+        rows.push_back(makePageRow(page, transactions.list[i]));
+        state.dirty.insert(rows.back().get());
       }
-      rows = std::move(addedFront);
+      state.orderChanged = true;
     }
-    rows.insert(end(rows), std::make_move_iterator(begin(addedBack)), std::make_move_iterator(end(addedBack)));
+    ready += static_cast<int>(rows.size());
+    total += count;
   };
 
-  auto addDePool = [&](const QString &address) {
-    if (_knownDePools.insert(address).second) {
-      _dePoolDetailsRequests.fire(&address);
+  // The shown page goes first, so that it gets painted as soon as possible.
+  const auto current = currentPage();
+  const auto currentIt = _transactions.find(current);
+  if (currentIt != end(_transactions)) {
+    ingest(current, currentIt->second);
+  }
+  for (const auto &[page, transactions] : _transactions) {
+    if (page != current) {
+      ingest(page, transactions);
     }
-  };
+  }
 
-  auto requestDetails = [this](const Ton::Transaction &transaction) {
-    if (!transaction.incoming.source.isEmpty()) {
-      _tokenDetailsRequests.fire(&transaction);
+  _ingestionProgress = (ready < total) ? (float64(ready) / total) : 1.;
+  if (ready < total && !_ingestionScheduled) {
+    _ingestionScheduled = true;
+    crl::on_main(this, [=] {
+      _ingestionScheduled = false;
+      ingestRows();
+      enforceMemoryBudget();
+      refreshShowDates(_selectedAsset.current());
+    });
+  }
+}
+
+void History::enforceMemoryBudget() {
+  // Measured again after each step, a page whose rows share pool blocks
+  // with other pages may free less than it held.
+  const auto measure = [&] {
+    auto result = HistoryRowPool().reservedBytes();
+    for (const auto &[page, rows] : _rows) {
+      result += int64(rows.regular.size() + rows.pending.size()) * kRowBytesEstimate;
+    }
+    for (const auto &[page, transactions] : _transactions) {
+      result += int64(transactions.list.size()) * kTransactionBytesEstimate;
     }
+    return result;
   };
+  auto usage = measure();
+  if (usage <= kMemoryBudget) {
+    return;
+  }
 
+  // Least recently viewed first, the pages never shown have no view time at all.
+  const auto current = currentPage();
+  auto inactive = std::vector<std::pair<crl::time, HistoryPageKey>>();
   for (const auto &[page, transactions] : _transactions) {
-    auto rowsIt = _rows.find(page);
-    if (rowsIt == end(_rows)) {
-      rowsIt = _rows
-                   .emplace(std::piecewise_construct, std::forward_as_tuple(page),
-                            std::forward_as_tuple(RowsState{.regular = std::vector<std::unique_ptr<HistoryRow>>{}}))
-                   .first;
+    if (page != current) {
+      inactive.emplace_back(transactions.lastViewed, page);
     }
-    if (page == kMainPageKey) {
-      mergeTransactions(rowsIt->second.regular, transactions.list, [&](const Ton::Transaction &transaction) {
-        v::match(
-            transaction.additional,  //
-            [&](const Ton::TokenWalletDeployed &event) {
-              if (_knownRootTokenContracts.insert(event.rootTokenContract).second) {
-                _tokenDetailsRequests.fire(&transaction);
-              }
-            },
-            [&](const Ton::EthEventStatusChanged &) { requestDetails(transaction); },
-            [&](const Ton::TonEventStatusChanged &) { requestDetails(transaction); },
-            [&](const Ton::DePoolOrdinaryStakeTransaction &) {
-              for (const auto &out : transaction.outgoing) {
-                addDePool(out.destination);
-                break;
-              }
-            },
-            [&](const Ton::DePoolOnRoundCompleteTransaction &) {
-              if (!transaction.incoming.source.isEmpty()) {
-                addDePool(transaction.incoming.source);
-              }
-            },
-            [](auto &&) {});
-        return makeRow(transaction);
-      });
-    } else {
-      mergeTransactions(rowsIt->second.regular, transactions.list,
-                        [&](const Ton::Transaction &transaction) { return makeRow(transaction); });
+  }
+  ranges::sort(inactive);
+
+  // Rows are rebuilt from the transactions when the page is shown again, so they go first.
+  for (const auto &[lastViewed, page] : inactive) {
+    if (usage <= kMemoryBudget) {
+      return;
+    }
+    const auto it = _rows.find(page);
+    if (it == end(_rows) || it->second.regular.empty()) {
+      continue;
     }
+    auto &rows = it->second;
+    for (const auto &row : rows.regular) {
+      forgetRow(rows, row.get());
+    }
+    rows.regular.clear();
+    rows.allDirty = true;
+    _evictedRows.insert(page);
+    usage = measure();
   }
 
-  refreshShowDates(selectedAsset);
+  // Older slices are read back by checkPreload() once the page is scrolled, from
+  // the cache when there is one. The analytics totals are kept, they deduplicate
+  // the reloaded transactions.
+  for (const auto &[lastViewed, page] : inactive) {
+    if (usage <= kMemoryBudget) {
+      return;
+    }
+    auto &transactions = _transactions[page];
+    const auto kept = std::max(transactions.latestCount, kEvictionKeptTransactions);
+    if (int(transactions.list.size()) <= kept) {
+      continue;
+    }
+    transactions.previousId = transactions.list[kept]->id;
+    transactions.list.resize(kept);
+    transactions.requestedLt = 0;
+    transactions.evictedToCache = (_cache != nullptr);
+    transactions.reindex();
+    transactions.search.clear();
+    for (const auto &transaction : transactions.list) {
+      transactions.search.add(*transaction, page.first);
+    }
+    transactions.searchMatches = std::nullopt;
+    _analytics.setComplete(page, transactions.analyticsComplete);
+    usage = measure();
+  }
+}
+
+std::unique_ptr<HistoryRow> History::makePageRow(const HistoryPageKey &page, const TransactionPtr &shared) {
+  if (page != kMainPageKey) {
+    return makeRow(shared);
+  }
+  const auto &transaction = *shared;
+
+  const auto addDePool = [&](const QString &address) {
+    if (_knownDePools.insert(address).second) {
+      _dePoolDetailsRequests.fire(&address);
+    }
+  };
+  const auto requestDetails = [&] {
+    if (!transaction.incoming.source.isEmpty()) {
+      _tokenDetailsRequests.fire(&transaction);
+    }
+  };
+  v::match(
+      transaction.additional,  //
+      [&](const Ton::TokenWalletDeployed &event) {
+        if (_knownRootTokenContracts.insert(event.rootTokenContract).second) {
+          _tokenDetailsRequests.fire(&transaction);
+        }
+      },
+      [&](const Ton::EthEventStatusChanged &) { requestDetails(); },
+      [&](const Ton::TonEventStatusChanged &) { requestDetails(); },
+      [&](const Ton::DePoolOrdinaryStakeTransaction &) {
+        for (const auto &out : transaction.outgoing) {
+          addDePool(out.destination);
+          break;
+        }
+      },
+      [&](const Ton::DePoolOnRoundCompleteTransaction &) {
+        if (!transaction.incoming.source.isEmpty()) {
+          addDePool(transaction.incoming.source);
+        }
+      },
+      [](auto &&) {});
+  return makeRow(shared);
 }
 
 void History::repaintRow(not_null<HistoryRow *> row) {
-  _widget.update(0, row->top(), _widget.width(), row->height());
+  const auto it = _rows.find(currentPage());
+  const auto top = (it != _rows.end()) ? syncRowTop(it->second, row) : row->top();
+  _widget.update(0, top, _widget.width(), row->height());
 }
 
 void History::repaintShadow(not_null<HistoryRow *> row) {
-  const auto min = std::min(row->top(), _visibleTop);
-  const auto delta = std::max(row->top(), _visibleTop) - min;
+  const auto it = _rows.find(currentPage());
+  const auto top = (it != _rows.end()) ? syncRowTop(it->second, row) : row->top();
+  const auto min = std::min(top, _visibleTop);
+  const auto delta = std::max(top, _visibleTop) - min;
   _widget.update(0, min, _widget.width(), delta + st::walletRowDateHeight);
 }
 
-void History::checkPreload() const {
+int History::preloadScreens(const TransactionsState &transactions) const {
   const auto visibleHeight = (_visibleBottom - _visibleTop);
-  const auto preloadHeight = kPreloadScreens * visibleHeight;
+  if (visibleHeight <= 0) {
+    return kPreloadScreens;
+  }
+  // Screens scrolled through while the next slice is on its way.
+  const auto latency = transactions.latency ? transactions.latency : kPreloadDefaultLatency;
+  const auto ahead = int(std::ceil(_scrollVelocity * latency / visibleHeight));
+  return std::clamp(kPreloadScreens + ahead, kPreloadScreens, kPreloadScreensMax);
+}
 
+void History::checkPreload() {
   const auto page = currentPage();
 
+  // Rows of the loaded transactions are still being ingested.
+  const auto rowsIt = _rows.find(page);
   const auto it = _transactions.find(page);
-  if (it != _transactions.end() && _visibleBottom + preloadHeight >= _widget.height() &&
-      it->second.previousId.lt != 0) {
-    _preloadRequests.fire_copy(std::make_pair(page, it->second.previousId));
+  if (it != _transactions.end() && rowsIt != _rows.end() &&
+      rowsIt->second.regular.size() < it->second.list.size()) {
+    return;
+  }
+  if (it == _transactions.end() || !it->second.previousId.lt) {
+    return;
+  }
+  auto &transactions = it->second;
+  const auto preloadHeight = preloadScreens(transactions) * (_visibleBottom - _visibleTop);
+  if (_visibleBottom + preloadHeight < _widget.height()) {
+    return;
   }
+  const auto now = crl::now();
+  if (transactions.requestedLt == transactions.previousId.lt &&
+      now - transactions.requestedAt < kPreloadRetryTimeout) {
+    ++_preloadStats.deduped;
+    return;
+  }
+  transactions.requestedLt = transactions.previousId.lt;
+  transactions.requestedAt = now;
+  if (transactions.evictedToCache) {
+    transactions.evictedToCache = false;
+    _cache->load(page, crl::guard(this, [=](std::optional<Ton::TransactionsSlice> cached) {
+      if (cached && applyCached(page, std::move(*cached), false)) {
+        return;
+      } else if (const auto it = _transactions.find(page); it != end(_transactions)) {
+        // The page file does not continue the list, fall back to the network.
+        it->second.requestedLt = 0;
+        checkPreload();
+      }
+    }));
+    return;
+  }
+  ++_preloadStats.issued;
+  _preloadRequests.fire_copy(std::make_pair(page, transactions.previousId));
+}
+
+const HistoryPreloadStats &History::preloadStats() const {
+  return _preloadStats;
 }
 
 HistoryPageKey History::currentPage() const {
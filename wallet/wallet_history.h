@@ -10,10 +10,14 @@
 
 #include "ui/rp_widget.h"
 #include "ui/click_handler.h"
+#include "base/weak_ptr.h"
 
 #include "wallet_common.h"
+#include "wallet_history_analytics.h"
+#include "wallet_history_search.h"
 
 #include <QSet>
+#include <unordered_map>
 
 class Painter;
 
@@ -28,9 +32,18 @@ struct HistoryState {
   std::map<QString, int64> multisigTimeouts;
 };
 
+// Slice requests of checkPreload(): issued, skipped because the same slice
+// was already in flight, and received when nothing could use them anymore.
+struct HistoryPreloadStats {
+  int issued = 0;
+  int deduped = 0;
+  int wasted = 0;
+};
+
 class HistoryRow;
+class HistoryCache;
 
-class History final {
+class History final : public base::has_weak_ptr {
  public:
   History(not_null<Ui::RpWidget *> parent, rpl::producer<HistoryState> state,
           rpl::producer<std::pair<HistoryPageKey, Ton::LoadedSlice>> loaded,
@@ -38,19 +51,24 @@ class History final {
           rpl::producer<not_null<const std::vector<Ton::Transaction> *>> updateDecrypted,
           rpl::producer<not_null<std::map<QString, QString> *>> updateWalletOwners,
           rpl::producer<NotificationsHistoryUpdate> updateNotifications,
-          rpl::producer<std::optional<SelectedAsset>> selectedAsset);
+          rpl::producer<std::optional<SelectedAsset>> selectedAsset, HistoryCache *cache = nullptr);
   ~History();
 
   void updateGeometry(QPoint position, int width);
   [[nodiscard]] rpl::producer<int> heightValue() const;
   void setVisible(bool visible);
   void setVisibleTopBottom(int top, int bottom);
+  void setSearchQuery(const QString &query);
 
   [[nodiscard]] rpl::producer<std::pair<HistoryPageKey, Ton::TransactionId>> preloadRequests() const;
-  [[nodiscard]] rpl::producer<Ton::Transaction> viewRequests() const;
-  [[nodiscard]] rpl::producer<Ton::Transaction> decryptRequests() const;
+  [[nodiscard]] rpl::producer<TransactionPtr> viewRequests() const;
+  [[nodiscard]] rpl::producer<TransactionPtr> decryptRequests() const;
   [[nodiscard]] rpl::producer<std::pair<const Ton::Symbol *, const QSet<QString> *>> ownerResolutionRequests() const;
 
+  [[nodiscard]] rpl::producer<float64> ingestionProgress() const;
+  [[nodiscard]] const HistoryPreloadStats &preloadStats() const;
+  [[nodiscard]] rpl::producer<HistoryAnalyticsResult> analytics(HistoryAnalyticsQuery query) const;
+
   [[nodiscard]] rpl::producer<not_null<const QString *>> dePoolDetailsRequests() const;
   [[nodiscard]] rpl::producer<not_null<const Ton::Transaction *>> tokenDetailsRequests() const;
 
@@ -66,6 +84,26 @@ class History final {
     int offset = 0;
   };
 
+  // Prefix sums of the row heights in the merged order, so that a single row
+  // can be resized and a row can be found by its offset in O(log n).
+  class RowOffsets final {
+   public:
+    void build(std::vector<int> &&heights);
+    void set(int index, int height);
+
+    [[nodiscard]] int count() const;
+    [[nodiscard]] int total() const;
+    [[nodiscard]] int top(int index) const;
+    [[nodiscard]] int height(int index) const;
+    [[nodiscard]] int findByOffset(int offset) const;
+
+   private:
+    std::vector<int> _heights;
+    std::vector<int> _tree;
+    int _total = 0;
+    int _highBit = 0;
+  };
+
   void setupContent(rpl::producer<HistoryState> &&state,
                     rpl::producer<std::pair<HistoryPageKey, Ton::LoadedSlice>> &&loaded,
                     rpl::producer<std::optional<SelectedAsset>> &&selectedAsset);
@@ -75,11 +113,13 @@ class History final {
   void mergeNotifications(NotificationsHistoryUpdate &&update);
   bool mergeListChanged(std::map<HistoryPageKey, Ton::TransactionsSlice> &&data);
   void refreshRows(const SelectedAsset &selectedAsset);
+  void ingestRows();
+  void enforceMemoryBudget();
   void refreshPending();
   void paint(Painter &p, QRect clip);
   void repaintRow(not_null<HistoryRow *> row);
   void repaintShadow(not_null<HistoryRow *> row);
-  void checkPreload() const;
+  void checkPreload();
 
   void selectRow(const std::pair<bool, int> &selected, const ClickHandlerPtr &handler);
   void selectRowByMouse();
@@ -88,24 +128,104 @@ class History final {
   void decryptById(const Ton::TransactionId &id);
 
   void refreshShowDates(const SelectedAsset &selectedAsset);
-  void setRowShowDate(not_null<HistoryRow *> row, bool show = true);
-  bool takeDecrypted(int index, const std::vector<Ton::Transaction> &decrypted);
-  [[nodiscard]] std::unique_ptr<HistoryRow> makeRow(const Ton::Transaction &data);
+  void takeDecrypted(int index, const Ton::Transaction &decrypted);
+  [[nodiscard]] std::unique_ptr<HistoryRow> makeRow(TransactionPtr data);
+  [[nodiscard]] std::unique_ptr<HistoryRow> makePageRow(const HistoryPageKey &page, const TransactionPtr &shared);
   [[nodiscard]] HistoryPageKey currentPage() const;
 
   struct TransactionsState {
-    std::vector<Ton::Transaction> list;
+    std::vector<TransactionPtr> list;
     Ton::TransactionId previousId;
     int64 latestScannedTransactionLt = 0;
     int64 leastScannedTransactionLt = std::numeric_limits<int64>::max();
+
+    // Positions of the transactions by lt, shifted by firstPosition,
+    // so that the list can grow from both ends without reindexing.
+    std::unordered_map<int64, int> positions;
+    int firstPosition = 0;
+
+    void reindex();
+    void indexFront(int count);
+    void indexBack(int count);
+    [[nodiscard]] int indexOf(const Ton::TransactionId &id) const;
+
+    // The slice requested by checkPreload() and not received yet, and the
+    // smoothed time it takes for a slice of this page to arrive.
+    int64 requestedLt = 0;
+    crl::time requestedAt = 0;
+    crl::time latency = 0;
+
+    // Transactions which came with the wallet state rather than preloaded, kept
+    // when the page is evicted, and the time the page was last shown.
+    int latestCount = 0;
+    crl::time lastViewed = 0;
+
+    // Evicted slices are read back from the cache rather than preloaded, and
+    // the analytics totals stay complete once the whole page was counted.
+    bool evictedToCache = false;
+    bool analyticsComplete = false;
+
+    // Matches of the current search query, dropped when the index changes.
+    HistorySearchIndex search;
+    std::optional<std::vector<int64>> searchMatches;
   };
 
+  struct PreparedLayout;
+
   struct RowsState {
     std::vector<std::unique_ptr<HistoryRow>> pending;
     std::vector<std::unique_ptr<HistoryRow>> regular;
+    std::vector<not_null<HistoryRow *>> materialized;
+
+    // Pending and regular rows merged by lt, newest first.
+    std::vector<not_null<HistoryRow *>> order;
+    bool orderChanged = false;
+
+    // Row geometry and flags by order index, rows from the resized set are remeasured
+    // on the next layoutRows(). Scans check the flags before touching the rows.
+    RowOffsets offsets;
+    std::vector<uchar> flags;
+
+    // Order indices of the rows showing a date header, the day boundaries.
+    base::flat_set<int> dateHeaders;
+    int layoutWidth = 0;
+    base::flat_set<HistoryRow *> resized;
+
+    // Rows which have to be filtered again on the next refreshShowDates().
+    std::optional<SelectedAsset> appliedAsset;
+    bool allDirty = true;
+    bool datesDirty = false;
+    base::flat_set<HistoryRow *> dirty;
+
+    // Derived state of the rows filtered so far, kept between the passes.
+    std::map<QString, not_null<HistoryRow *>> latestEthStatuses;
+    std::map<QString, not_null<HistoryRow *>> latestTonStatuses;
+    base::flat_set<int64> executedTransactions;
+    std::map<int64, std::vector<not_null<HistoryRow *>>> pendingSubmits;
+    std::map<QString, std::vector<not_null<HistoryRow *>>> unresolvedOwners;
+    base::flat_set<HistoryRow *> timedRows;
   };
 
+  RowsState &rowsState(const HistoryPageKey &page);
+  TransactionsState &transactionsState(const HistoryPageKey &page);
+  bool applyCached(const HistoryPageKey &page, Ton::TransactionsSlice &&cached, bool writeBack);
+  void indexTransactions(const HistoryPageKey &page, TransactionsState &transactions, int from, int till);
+  [[nodiscard]] const std::vector<int64> *searchMatches(const HistoryPageKey &page);
+  [[nodiscard]] int preloadScreens(const TransactionsState &transactions) const;
+
+  int layoutRows(RowsState &rows, int width);
+  int syncRowTop(const RowsState &rows, not_null<HistoryRow *> row);
+  void materializeRows(RowsState &rows);
+  void prepareLayouts(std::vector<not_null<HistoryRow *>> &&rows);
+  void commitLayouts(std::vector<PreparedLayout> &&batch);
+  void forgetRow(RowsState &rows, not_null<HistoryRow *> row);
+  void setRowShowDate(RowsState &rows, not_null<HistoryRow *> row, bool show = true);
+  [[nodiscard]] QDate previousDate(const RowsState &rows, int index) const;
+  void rebuildOrder(RowsState &rows);
+  void resetDerivedState(RowsState &rows);
+
   Ui::RpWidget _widget;
+  HistoryCache *const _cache = nullptr;
 
   bool _pendingDataChanged{};
   std::vector<Ton::PendingTransaction> _pendingData;
@@ -113,6 +233,7 @@ class History final {
 
   rpl::variable<SelectedAsset> _selectedAsset;
   std::map<HistoryPageKey, RowsState> _rows;
+  base::flat_set<HistoryPageKey> _evictedRows;
   std::map<QString, QString> _tokenOwners;
 
   QSet<QString> _knownContracts;
@@ -121,15 +242,26 @@ class History final {
 
   std::map<QString, int64> _multisigTimeouts;
 
+  QString _searchQuery;
+  HistoryAnalytics _analytics;
+
+  rpl::variable<float64> _ingestionProgress = 1.;
+  bool _ingestionScheduled = false;
+
   int _visibleTop = 0;
   int _visibleBottom = 0;
 
+  // Downward scroll speed in pixels per ms, scaling the preload distance.
+  float64 _scrollVelocity = 0.;
+  crl::time _scrollTime = 0;
+  HistoryPreloadStats _preloadStats;
+
   std::pair<bool, int> _selected = std::make_pair(false, -1);
   std::pair<bool, int> _pressed = std::make_pair(false, -1);
 
   rpl::event_stream<std::pair<HistoryPageKey, Ton::TransactionId>> _preloadRequests;
-  rpl::event_stream<Ton::Transaction> _viewRequests;
-  rpl::event_stream<Ton::Transaction> _decryptRequests;
+  rpl::event_stream<TransactionPtr> _viewRequests;
+  rpl::event_stream<TransactionPtr> _decryptRequests;
   rpl::event_stream<std::pair<const Ton::Symbol *, const QSet<QString> *>> _ownerResolutionRequests;
 
   rpl::event_stream<not_null<const QString *>> _dePoolDetailsRequests;
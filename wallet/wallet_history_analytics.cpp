@@ -0,0 +1,178 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_history_analytics.h"
+
+#include "base/unixtime.h"
+#include "base/weak_ptr.h"
+
+#include <crl/crl_async.h>
+
+namespace Wallet {
+namespace {
+
+struct Contribution {
+  QString counterparty;
+  int128 received = 0;
+  int128 sent = 0;
+};
+
+[[nodiscard]] Contribution ComputeContribution(const Ton::Transaction &transaction, const Ton::Symbol &symbol) {
+  auto result = Contribution();
+  if (symbol.isToken()) {
+    v::match(
+        transaction.additional,
+        [&](const Ton::TokenTransfer &transfer) {
+          result.counterparty = RawAddress(transfer.address);
+          (transfer.incoming ? result.received : result.sent) = transfer.value;
+        },
+        [&](const Ton::TokenSwapBack &swapBack) {
+          result.counterparty = swapBack.address;
+          result.sent = swapBack.value;
+        },
+        [&](const Ton::TokenMint &mint) { result.received = mint.value; },
+        [&](const Ton::TokensBounced &bounced) { result.received = bounced.amount; },
+        [](auto &&) {});
+    return result;
+  }
+
+  const auto address = ExtractAddress(transaction);
+  result.counterparty = address.isEmpty() ? QString() : RawAddress(address);
+  if (!IsServiceTransaction(transaction)) {
+    const auto value = CalculateValue(transaction);
+    if (value > 0) {
+      result.received = value;
+    } else {
+      result.sent = -value;
+    }
+  }
+  return result;
+}
+
+[[nodiscard]] HistoryAnalyticsResult ComputeResult(const HistoryAnalytics::Snapshot &pages,
+                                                   const HistoryAnalyticsQuery &query) {
+  using Key = std::tuple<std::optional<HistoryPageKey>, QString, int>;
+  auto grouped = std::map<Key, HistoryAggregate>();
+  auto complete = !query.page.has_value() || (pages.find(*query.page) != end(pages));
+  for (const auto &[page, totals] : pages) {
+    if (query.page.has_value() && *query.page != page) {
+      continue;
+    }
+    complete = complete && totals->complete;
+    for (const auto &[key, total] : totals->byCounterpartyAndMonth) {
+      const auto &[counterparty, month] = key;
+      if (month < query.fromMonth || month > query.tillMonth ||
+          (!query.counterparty.isEmpty() && counterparty != query.counterparty)) {
+        continue;
+      }
+      auto &sum = grouped[Key{
+          (query.groups & HistoryAnalyticsGroup::Page) ? std::make_optional(page) : std::nullopt,
+          (query.groups & HistoryAnalyticsGroup::Counterparty) ? counterparty : QString(),
+          (query.groups & HistoryAnalyticsGroup::Month) ? month : 0,
+      }];
+      sum.received += total.received;
+      sum.sent += total.sent;
+      sum.fees += total.fees;
+      sum.count += total.count;
+    }
+  }
+
+  auto result = HistoryAnalyticsResult{.complete = complete};
+  result.rows.reserve(grouped.size());
+  for (auto &[key, total] : grouped) {
+    auto &[page, counterparty, month] = key;
+    result.rows.push_back(HistoryAnalyticsRow{
+        .page = page,
+        .counterparty = counterparty,
+        .month = month,
+        .total = total,
+    });
+  }
+  return result;
+}
+
+}  // namespace
+
+int HistoryMonth(int32 unixtime) {
+  const auto date = base::unixtime::parse(unixtime).date();
+  return date.year() * 12 + date.month() - 1;
+}
+
+void HistoryAnalytics::add(const HistoryPageKey &page, const std::vector<TransactionPtr> &list, int from, int till) {
+  Expects(from >= 0 && from <= till && till <= list.size());
+
+  auto &counted = _counted[page];
+  auto &current = _pages[page];
+  auto updated = std::shared_ptr<Totals>();
+  for (auto i = from; i != till; ++i) {
+    const auto &transaction = *list[i];
+    if (!counted.insert(transaction.id.lt).second) {
+      continue;
+    } else if (!updated) {
+      // Totals are shared with the running queries, so they are copied on write.
+      updated = current ? std::make_shared<Totals>(*current) : std::make_shared<Totals>();
+    }
+    const auto contribution = ComputeContribution(transaction, page.first);
+    auto &total = updated->byCounterpartyAndMonth[std::make_pair(contribution.counterparty,
+                                                                 HistoryMonth(transaction.time))];
+    total.received += contribution.received;
+    total.sent += contribution.sent;
+    total.fees += transaction.fee;
+    ++total.count;
+  }
+  if (updated) {
+    current = std::move(updated);
+    _changes.fire({});
+  } else if (!current) {
+    current = std::make_shared<Totals>();
+  }
+}
+
+void HistoryAnalytics::reset(const HistoryPageKey &page) {
+  _counted.erase(page);
+  if (_pages.erase(page)) {
+    _changes.fire({});
+  }
+}
+
+void HistoryAnalytics::setComplete(const HistoryPageKey &page, bool complete) {
+  auto &current = _pages[page];
+  if (current && current->complete == complete) {
+    return;
+  }
+  auto updated = current ? std::make_shared<Totals>(*current) : std::make_shared<Totals>();
+  updated->complete = complete;
+  current = std::move(updated);
+  _changes.fire({});
+}
+
+rpl::producer<HistoryAnalyticsResult> HistoryAnalytics::query(HistoryAnalyticsQuery query) const {
+  return [=](auto consumer) {
+    auto lifetime = rpl::lifetime();
+    const auto guard = lifetime.make_state<base::has_weak_ptr>();
+    const auto requested = lifetime.make_state<int>(0);
+
+    rpl::single(rpl::empty_value())  //
+        | rpl::then(_changes.events())  //
+        | rpl::start_with_next(
+              [=] {
+                // Only the latest of the overlapping runs gets delivered.
+                const auto id = ++*requested;
+                crl::async([=, pages = _pages] {
+                  auto result = ComputeResult(pages, query);
+                  crl::on_main(guard, [=, result = std::move(result)]() mutable {
+                    if (*requested == id) {
+                      consumer.put_next(std::move(result));
+                    }
+                  });
+                });
+              },
+              lifetime);
+    return lifetime;
+  };
+}
+
+}  // namespace Wallet
@@ -0,0 +1,83 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "base/flags.h"
+
+#include "wallet_common.h"
+
+#include <unordered_set>
+
+namespace Wallet {
+
+using HistoryPageKey = std::pair<Ton::Symbol, QString>;
+
+struct HistoryAggregate {
+  int128 received = 0;
+  int128 sent = 0;
+  int128 fees = 0;  // always in TON
+  int count = 0;
+};
+
+enum class HistoryAnalyticsGroup {
+  Page = 0x01,
+  Counterparty = 0x02,
+  Month = 0x04,
+};
+constexpr bool is_flag_type(HistoryAnalyticsGroup) {
+  return true;
+};
+using HistoryAnalyticsGroups = base::flags<HistoryAnalyticsGroup>;
+
+struct HistoryAnalyticsQuery {
+  std::optional<HistoryPageKey> page;
+  QString counterparty;  // raw address
+  int fromMonth = 0;
+  int tillMonth = std::numeric_limits<int>::max();
+  HistoryAnalyticsGroups groups = HistoryAnalyticsGroup::Page;
+};
+
+// Dimensions which are not grouped by are left empty.
+struct HistoryAnalyticsRow {
+  std::optional<HistoryPageKey> page;
+  QString counterparty;
+  int month = 0;
+  HistoryAggregate total;
+};
+
+struct HistoryAnalyticsResult {
+  std::vector<HistoryAnalyticsRow> rows;
+  bool complete = false;
+};
+
+// Index of a calendar month, year * 12 + month - 1, in the local time.
+[[nodiscard]] int HistoryMonth(int32 unixtime);
+
+// Running totals of every history page by counterparty and month, updated as
+// the slices are merged. Queries are answered from the totals on a worker
+// thread and answered again each time the totals change.
+class HistoryAnalytics final {
+ public:
+  void add(const HistoryPageKey &page, const std::vector<TransactionPtr> &list, int from, int till);
+  void reset(const HistoryPageKey &page);
+  void setComplete(const HistoryPageKey &page, bool complete);
+
+  [[nodiscard]] rpl::producer<HistoryAnalyticsResult> query(HistoryAnalyticsQuery query) const;
+
+  struct Totals {
+    std::map<std::pair<QString, int>, HistoryAggregate> byCounterpartyAndMonth;
+    bool complete = false;
+  };
+  using Snapshot = std::map<HistoryPageKey, std::shared_ptr<const Totals>>;
+
+ private:
+  Snapshot _pages;
+  std::map<HistoryPageKey, std::unordered_set<int64>> _counted;
+  rpl::event_stream<> _changes;
+};
+
+}  // namespace Wallet
@@ -0,0 +1,166 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_history_cache.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+namespace Wallet {
+namespace {
+
+constexpr auto kMagic = quint32(0x54574843);
+constexpr auto kVersion = quint32(1);
+
+enum class RecordType : quint8 {
+  Transaction = 1,
+  PreviousId = 2,
+};
+
+[[nodiscard]] QString HashName(const QString &value) {
+  return QString::fromLatin1(QCryptographicHash::hash(value.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
+
+[[nodiscard]] std::optional<Ton::TransactionsSlice> ReadPage(const QString &path, const HistoryCacheCodec &codec) {
+  auto file = QFile(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return std::nullopt;
+  }
+  auto stream = QDataStream(&file);
+  stream.setVersion(QDataStream::Qt_5_1);
+
+  auto magic = quint32();
+  auto version = quint32();
+  stream >> magic >> version;
+  if (stream.status() != QDataStream::Ok || magic != kMagic || version != kVersion) {
+    file.close();
+    file.remove();
+    return std::nullopt;
+  }
+
+  auto transactions = std::map<int64, Ton::Transaction, std::greater<>>();
+  auto previousId = std::optional<Ton::TransactionId>();
+  while (!stream.atEnd()) {
+    auto type = quint8();
+    stream >> type;
+    if (type == quint8(RecordType::Transaction)) {
+      auto lt = qint64();
+      auto serialized = QByteArray();
+      stream >> lt >> serialized;
+      if (stream.status() != QDataStream::Ok) {
+        break;
+      }
+      if (auto transaction = codec.deserialize(serialized)) {
+        transactions.insert_or_assign(lt, std::move(*transaction));
+      }
+    } else if (type == quint8(RecordType::PreviousId)) {
+      auto lt = qint64();
+      auto hash = QByteArray();
+      stream >> lt >> hash;
+      if (stream.status() != QDataStream::Ok) {
+        break;
+      }
+      previousId = Ton::TransactionId();
+      previousId->lt = lt;
+      previousId->hash = std::move(hash);
+    } else {
+      break;
+    }
+  }
+
+  // A torn tail is fine, everything before it was written completely.
+  if (transactions.empty() || !previousId.has_value()) {
+    return std::nullopt;
+  }
+  auto result = Ton::TransactionsSlice();
+  result.list.reserve(transactions.size());
+  for (auto &[lt, transaction] : transactions) {
+    result.list.push_back(std::move(transaction));
+  }
+  result.previousId = std::move(*previousId);
+  return result;
+}
+
+bool WritePage(const QString &path, const HistoryCacheCodec &codec, const std::vector<TransactionPtr> &list,
+               const std::optional<Ton::TransactionId> &previousId, bool truncate) {
+  auto file = QFile(path);
+  if (!truncate && !file.exists()) {
+    // Slices are only meaningful on top of the page they continue.
+    return false;
+  }
+  const auto mode = QIODevice::WriteOnly | (truncate ? QIODevice::Truncate : QIODevice::Append);
+  if (!file.open(mode)) {
+    return false;
+  }
+  auto stream = QDataStream(&file);
+  stream.setVersion(QDataStream::Qt_5_1);
+
+  if (truncate) {
+    stream << kMagic << kVersion;
+  }
+  for (const auto &transaction : list) {
+    stream << quint8(RecordType::Transaction) << qint64(transaction->id.lt) << codec.serialize(*transaction);
+  }
+  if (previousId) {
+    stream << quint8(RecordType::PreviousId) << qint64(previousId->lt) << previousId->hash;
+  }
+  return (stream.status() == QDataStream::Ok);
+}
+
+}  // namespace
+
+HistoryCache::HistoryCache(const QString &path, HistoryCacheCodec codec)
+    : _basePath(path), _codec(std::make_shared<HistoryCacheCodec>(std::move(codec))) {
+  Expects(_codec->serialize != nullptr && _codec->deserialize != nullptr);
+}
+
+void HistoryCache::setAccount(const QString &address, bool useTestNetwork) {
+  _accountPath = _basePath + '/' + HashName(address + (useTestNetwork ? ":test" : ":main"));
+  _queue.async([path = _accountPath] { QDir().mkpath(path); });
+}
+
+QString HistoryCache::pagePath(const HistoryPageKey &page) const {
+  const auto &symbol = page.first;
+  return _accountPath + '/' + HashName(symbol.name() + ':' + symbol.rootContractAddress() + ':' + page.second);
+}
+
+void HistoryCache::load(const HistoryPageKey &page, Fn<void(std::optional<Ton::TransactionsSlice>)> done) {
+  if (_accountPath.isEmpty()) {
+    done(std::nullopt);
+    return;
+  }
+  _queue.async([path = pagePath(page), codec = _codec, done = std::move(done)]() mutable {
+    auto result = ReadPage(path, *codec);
+    crl::on_main([done = std::move(done), result = std::move(result)]() mutable { done(std::move(result)); });
+  });
+}
+
+void HistoryCache::reset(const HistoryPageKey &page, const std::vector<TransactionPtr> &list,
+                         const Ton::TransactionId &previousId) {
+  write(page, list, previousId, true);
+}
+
+void HistoryCache::prepend(const HistoryPageKey &page, const std::vector<TransactionPtr> &list) {
+  write(page, list, std::nullopt, false);
+}
+
+void HistoryCache::append(const HistoryPageKey &page, const std::vector<TransactionPtr> &list,
+                          const Ton::TransactionId &previousId) {
+  write(page, list, previousId, false);
+}
+
+void HistoryCache::write(const HistoryPageKey &page, const std::vector<TransactionPtr> &list,
+                         std::optional<Ton::TransactionId> previousId, bool truncate) {
+  if (_accountPath.isEmpty()) {
+    return;
+  }
+  // The transactions are shared and immutable, so the worker reads them as they are.
+  _queue.async([=, path = pagePath(page), codec = _codec] { WritePage(path, *codec, list, previousId, truncate); });
+}
+
+}  // namespace Wallet
@@ -0,0 +1,51 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "ton/ton_state.h"
+
+#include "wallet_common.h"
+
+#include <crl/crl_queue.h>
+
+namespace Wallet {
+
+using HistoryPageKey = std::pair<Ton::Symbol, QString>;
+
+// Transactions are stored as opaque blobs, the format of Ton::Transaction
+// itself belongs to the library which defines it. Called on a worker thread.
+struct HistoryCacheCodec {
+  Fn<QByteArray(const Ton::Transaction &)> serialize;
+  Fn<std::optional<Ton::Transaction>(const QByteArray &)> deserialize;
+};
+
+// Append-only cache of the loaded history pages of a single account,
+// one versioned file per page, with the records keyed by lt. The files are
+// read and written in order on a worker queue, loads answer on the main thread.
+class HistoryCache final {
+ public:
+  HistoryCache(const QString &path, HistoryCacheCodec codec);
+
+  void setAccount(const QString &address, bool useTestNetwork);
+
+  void load(const HistoryPageKey &page, Fn<void(std::optional<Ton::TransactionsSlice>)> done);
+  void reset(const HistoryPageKey &page, const std::vector<TransactionPtr> &list, const Ton::TransactionId &previousId);
+  void prepend(const HistoryPageKey &page, const std::vector<TransactionPtr> &list);
+  void append(const HistoryPageKey &page, const std::vector<TransactionPtr> &list, const Ton::TransactionId &previousId);
+
+ private:
+  [[nodiscard]] QString pagePath(const HistoryPageKey &page) const;
+  void write(const HistoryPageKey &page, const std::vector<TransactionPtr> &list,
+             std::optional<Ton::TransactionId> previousId, bool truncate);
+
+  const QString _basePath;
+  const std::shared_ptr<const HistoryCacheCodec> _codec;
+  QString _accountPath;
+  crl::queue _queue;
+};
+
+}  // namespace Wallet
@@ -0,0 +1,179 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_history_search.h"
+
+#include "wallet/wallet_common.h"
+
+namespace Wallet {
+namespace {
+
+// Shorter terms match only exactly, prefixes like "0:" or "eq" match almost
+// every transaction and are useless as a filter.
+constexpr auto kMinPrefixLength = 3;
+
+// The candidates are checked one by one instead of walking the postings once
+// at most this share of the transactions is left.
+constexpr auto kNarrowShare = 32;
+
+[[nodiscard]] bool IsTermChar(QChar ch) {
+  return ch.isLetterOrNumber() || ch == ':' || ch == '.' || ch == ',' || ch == '-' || ch == '_' || ch == '+' ||
+         ch == '/';
+}
+
+// Both the indexed texts and the queries are split the same way, amounts are
+// normalized to a dot separator to match regardless of the locale.
+template <typename Callback>
+void EnumerateTerms(const QString &text, Callback &&callback) {
+  auto from = -1;
+  for (auto i = 0, count = static_cast<int>(text.size()); i <= count; ++i) {
+    if (i < count && IsTermChar(text[i])) {
+      if (from < 0) {
+        from = i;
+      }
+    } else if (from >= 0) {
+      callback(text.mid(from, i - from).toLower().replace(',', '.'));
+      from = -1;
+    }
+  }
+}
+
+[[nodiscard]] bool MatchesTerm(const QString &indexed, const QString &term) {
+  return (term.size() < kMinPrefixLength) ? (indexed == term) : indexed.startsWith(term);
+}
+
+template <typename Callback>
+void EnumeratePostings(const std::map<QString, std::vector<int>> &postings, const QString &term, Callback &&callback) {
+  if (term.size() < kMinPrefixLength) {
+    if (const auto i = postings.find(term); i != end(postings)) {
+      callback(i->second);
+    }
+    return;
+  }
+  for (auto i = postings.lower_bound(term); i != end(postings) && i->first.startsWith(term); ++i) {
+    callback(i->second);
+  }
+}
+
+}  // namespace
+
+void HistorySearchIndex::add(const Ton::Transaction &transaction, const Ton::Symbol &symbol) {
+  const auto lt = transaction.id.lt;
+  const auto index = ordinal(lt);
+  const auto push = [&](const QString &term) {
+    auto &list = _postings[term];
+    if (list.empty() || list.back() != index) {
+      list.push_back(index);
+      _terms[index].push_back(term);
+    }
+  };
+  const auto addText = [&](const QString &text) { EnumerateTerms(text, push); };
+  const auto addAddress = [&](const QString &address) {
+    if (!address.isEmpty()) {
+      addText(address);
+      addText(RawAddress(address));
+    }
+  };
+  const auto addAmount = [&](const int128 &amount) {
+    addText(FormatAmount(amount < 0 ? int128(-amount) : amount, symbol, FormatFlag::Simple).full);
+  };
+
+  if (!IsEncryptedMessage(transaction)) {
+    addText(ExtractMessage(transaction));
+  }
+  addAddress(ExtractAddress(transaction));
+  v::match(
+      transaction.additional,
+      [&](const Ton::TokenTransfer &transfer) {
+        addAddress(transfer.address);
+        addAmount(transfer.value);
+      },
+      [&](const Ton::TokenSwapBack &swapBack) {
+        addText(swapBack.address);
+        addAmount(swapBack.value);
+      },
+      [&](const Ton::TokenMint &mint) { addAmount(mint.value); },
+      [&](const Ton::TokensBounced &bounced) { addAmount(bounced.amount); },
+      [&](auto &&) { addAmount(CalculateValue(transaction)); });
+  push(QString::fromLatin1(transaction.id.hash.toHex()));
+  push(QString::number(lt));
+}
+
+void HistorySearchIndex::clear() {
+  _postings.clear();
+  _ordinals.clear();
+  _lts.clear();
+  _terms.clear();
+}
+
+int HistorySearchIndex::ordinal(int64 lt) {
+  const auto [i, inserted] = _ordinals.emplace(lt, static_cast<int>(_lts.size()));
+  if (inserted) {
+    _lts.push_back(lt);
+    _terms.emplace_back();
+  }
+  return i->second;
+}
+
+std::vector<int64> HistorySearchIndex::find(const QString &query, const std::vector<int64> *within) const {
+  auto terms = std::vector<QString>();
+  EnumerateTerms(query, [&](const QString &term) { terms.push_back(term); });
+  if (terms.empty()) {
+    return {};
+  }
+
+  auto result = std::vector<int64>();
+  if (within && within->size() * kNarrowShare <= _lts.size()) {
+    for (const auto lt : *within) {
+      const auto i = _ordinals.find(lt);
+      if (i == end(_ordinals)) {
+        continue;
+      }
+      const auto &indexed = _terms[i->second];
+      const auto matches = ranges::all_of(terms, [&](const QString &term) {
+        return ranges::any_of(indexed, [&](const QString &value) { return MatchesTerm(value, term); });
+      });
+      if (matches) {
+        result.push_back(lt);
+      }
+    }
+    return result;
+  }
+
+  // Each transaction counts the terms it matched so far, a posting counts only
+  // if every previous term matched, which also skips the repeated ones.
+  auto counts = std::vector<int>(_lts.size());
+  auto required = 0;
+  for (const auto &term : terms) {
+    const auto previous = required++;
+    EnumeratePostings(_postings, term, [&](const std::vector<int> &list) {
+      for (const auto index : list) {
+        if (counts[index] == previous) {
+          counts[index] = required;
+        }
+      }
+    });
+  }
+  for (auto i = 0, count = static_cast<int>(counts.size()); i != count; ++i) {
+    if (counts[i] == required) {
+      result.push_back(_lts[i]);
+    }
+  }
+  ranges::sort(result);
+  return result;
+}
+
+bool HistorySearchIndex::Narrows(const QString &previous, const QString &query) {
+  if (previous.isEmpty() || !query.startsWith(previous)) {
+    return false;
+  }
+  // A short term matches exactly, once extended it matches by prefix.
+  auto result = true;
+  EnumerateTerms(previous, [&](const QString &term) { result = result && (term.size() >= kMinPrefixLength); });
+  return result;
+}
+
+}  // namespace Wallet
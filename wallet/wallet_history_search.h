@@ -0,0 +1,38 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "ton/ton_state.h"
+
+namespace Wallet {
+
+// Inverted index of a single history page: words of the comments, the
+// counterparty addresses in raw and packed forms, the formatted amounts and
+// the transaction ids, all mapped to the transactions they came from.
+class HistorySearchIndex final {
+ public:
+  void add(const Ton::Transaction &transaction, const Ton::Symbol &symbol);
+  void clear();
+
+  // Sorted lt of the transactions matching every term of the query, by prefix
+  // or exactly for the terms too short to be a useful prefix. Within are the
+  // matches of a query this one narrows, checked one by one when there are few.
+  [[nodiscard]] std::vector<int64> find(const QString &query, const std::vector<int64> *within = nullptr) const;
+
+  // Whether the matches of the query are a subset of the matches of previous.
+  [[nodiscard]] static bool Narrows(const QString &previous, const QString &query);
+
+ private:
+  [[nodiscard]] int ordinal(int64 lt);
+
+  std::map<QString, std::vector<int>> _postings;
+  std::unordered_map<int64, int> _ordinals;
+  std::vector<int64> _lts;
+  std::vector<std::vector<QString>> _terms;
+};
+
+}  // namespace Wallet
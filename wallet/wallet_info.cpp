@@ -13,11 +13,13 @@
 #include "wallet/wallet_history.h"
 #include "wallet/wallet_assets_list.h"
 #include "wallet/wallet_depool_info.h"
+#include "wallet/wallet_phrases.h"
 #include "ui/rp_widget.h"
 #include "ui/lottie_widget.h"
 #include "ui/widgets/labels.h"
 #include "ui/widgets/scroll_area.h"
 #include "ui/widgets/buttons.h"
+#include "ui/widgets/input_fields.h"
 #include "ui/text/text_utilities.h"
 #include "styles/style_wallet.h"
 #include <ui/wrap/slide_wrap.h>
@@ -78,11 +80,11 @@ rpl::producer<std::pair<HistoryPageKey, Ton::TransactionId>> Info::preloadReques
   return _preloadRequests.events();
 }
 
-rpl::producer<Ton::Transaction> Info::viewRequests() const {
+rpl::producer<TransactionPtr> Info::viewRequests() const {
   return _viewRequests.events();
 }
 
-rpl::producer<Ton::Transaction> Info::decryptRequests() const {
+rpl::producer<TransactionPtr> Info::decryptRequests() const {
   return _decryptRequests.events();
 }
 
@@ -186,7 +188,12 @@ void Info::setupControls(Data &&data) {
   const auto history = _widget->lifetime().make_state<History>(
       tonHistoryWrapper, MakeHistoryState(rpl::duplicate(state)), std::move(loaded), std::move(data.collectEncrypted),
       std::move(data.updateDecrypted), std::move(data.updateWalletOwners), std::move(data.updateNotifications),
-      _selectedAsset.value());
+      _selectedAsset.value(), data.historyCache);
+
+  // search field, filters the history in place
+  const auto search =
+      Ui::CreateChild<Ui::InputField>(tonHistoryWrapper, st::walletHistorySearchField, ph::lng_wallet_history_search());
+  Ui::Connect(search, &Ui::InputField::changed, [=] { history->setSearchQuery(search->getLastText()); });
 
   const auto emptyHistory = _widget->lifetime().make_state<EmptyHistory>(
       tonHistoryWrapper, MakeEmptyHistoryState(rpl::duplicate(state), _selectedAsset.value(), data.justCreated),
@@ -236,20 +243,26 @@ void Info::setupControls(Data &&data) {
                     return std::make_tuple(historyHeight, historyHeight == 0, false);
                   });
 
-              const auto innerHeight = std::max(size.height(), cover->height() + contentHeight);
+              const auto searching = !search->getLastText().trimmed().isEmpty();
+              const auto searchHeight = (!historyVisible || searching) ? st::walletHistorySearchHeight : 0;
+
+              const auto innerHeight = std::max(size.height(), cover->height() + searchHeight + contentHeight);
               _inner->setGeometry({0, 0, size.width(), innerHeight});
 
               const auto coverHeight = st::walletCoverHeight;
 
               cover->setGeometry(QRect(0, 0, size.width(), coverHeight));
+              search->setGeometry(QRect(0, coverHeight, size.width(), st::walletHistorySearchHeight)
+                                      .marginsRemoved(st::walletHistorySearchPadding));
               emptyHistory->setGeometry(QRect(0, coverHeight, size.width(), size.height() - coverHeight));
               //dePoolInfo->setGeometry(QRect(0, coverHeight, size.width(), size.height() - coverHeight));
 
-              emptyHistory->setVisible(historyVisible);
+              search->setVisible(searchHeight > 0);
+              emptyHistory->setVisible(historyVisible && !searching);
               //dePoolInfo->setVisible(dePoolInfoVisible);
 
               tonHistoryWrapper->setGeometry(QRect(0, 0, size.width(), innerHeight));
-              history->updateGeometry({0, st::walletCoverHeight}, size.width());
+              history->updateGeometry({0, coverHeight + searchHeight}, size.width());
             } else {
               const auto innerHeight = std::max(size.height(), tokensListHeight);
               _inner->setGeometry(QRect(0, 0, size.width(), innerHeight));
@@ -283,6 +296,9 @@ void Info::setupControls(Data &&data) {
   // initialize default layouts
   _selectedAsset.value() | rpl::start_with_next(
                                [=](const std::optional<SelectedAsset> &token) {
+                                 if (!token.has_value()) {
+                                   search->setText(QString());
+                                 }
                                  assetsListWrapper->setVisible(!token.has_value());
                                  tonHistoryWrapper->setVisible(token.has_value());
                                },
@@ -22,6 +22,7 @@ using HistoryPageKey = std::pair<Ton::Symbol, QString>;
 
 enum class Action;
 enum class InfoTransition;
+class HistoryCache;
 
 class Info final {
  public:
@@ -36,6 +37,7 @@ class Info final {
     rpl::producer<InfoTransition> transitionEvents;
     Fn<void(QImage, QString)> share;
     Fn<void()> openGate;
+    HistoryCache *historyCache = nullptr;
     bool justCreated = false;
     bool useTestNetwork = false;
   };
@@ -50,8 +52,8 @@ class Info final {
   [[nodiscard]] rpl::producer<CustomAsset> removeAssetRequests() const;
   [[nodiscard]] rpl::producer<std::pair<HistoryPageKey, Ton::TransactionId>> preloadRequests() const;
   [[nodiscard]] rpl::producer<std::pair<int, int>> assetsReorderRequests() const;
-  [[nodiscard]] rpl::producer<Ton::Transaction> viewRequests() const;
-  [[nodiscard]] rpl::producer<Ton::Transaction> decryptRequests() const;
+  [[nodiscard]] rpl::producer<TransactionPtr> viewRequests() const;
+  [[nodiscard]] rpl::producer<TransactionPtr> decryptRequests() const;
   [[nodiscard]] rpl::producer<std::pair<const Ton::Symbol *, const QSet<QString> *>> ownerResolutionRequests() const;
 
   [[nodiscard]] rpl::producer<not_null<const QString *>> dePoolDetailsRequests() const;
@@ -76,8 +78,8 @@ class Info final {
   rpl::event_stream<CustomAsset> _removeAssetRequests;
   rpl::event_stream<std::pair<int, int>> _assetsReorderRequests;
   rpl::event_stream<std::pair<HistoryPageKey, Ton::TransactionId>> _preloadRequests;
-  rpl::event_stream<Ton::Transaction> _viewRequests;
-  rpl::event_stream<Ton::Transaction> _decryptRequests;
+  rpl::event_stream<TransactionPtr> _viewRequests;
+  rpl::event_stream<TransactionPtr> _decryptRequests;
   rpl::event_stream<std::pair<const Ton::Symbol *, const QSet<QString> *>> _ownerResolutionRequests;
 
   rpl::event_stream<not_null<const QString *>> _dePoolDetailsRequests;
@@ -10,8 +10,10 @@
 #include "wallet/wallet_phrases.h"
 #include "ui/widgets/buttons.h"
 #include "ui/inline_token_icon.h"
+#include "ui/painter.h"
 #include "styles/style_wallet.h"
 #include "styles/style_layers.h"
+#include "styles/palette.h"
 
 namespace Wallet {
 
@@ -37,34 +39,52 @@ void InvoiceQrBox(not_null<Ui::GenericBox *> box, const QString &link, const Fn<
 
   const auto button = Ui::CreateChild<Ui::AbstractButton>(container);
 
-  auto qr = button->lifetime().make_state<QImage>();
-  *qr = Ui::TokenQr(symbol, link, st::walletInvoiceQrPixel,
-                    st::boxWidth - st::boxRowPadding.left() - st::boxRowPadding.right());
-
-  const int size = qr->width() / style::DevicePixelRatio();
+  const auto qr = button->lifetime().make_state<QImage>();
+  const auto pixel = st::walletInvoiceQrPixel;
+  const auto max = st::boxWidth - st::boxRowPadding.left() - st::boxRowPadding.right();
+  const auto size = Ui::TokenQrSize(link, pixel, max);
   const auto height = st::walletInvoiceQrSkip * 2 + size;
 
   container->setFixedHeight(height);
 
   button->resize(size, size);
 
-  button->setClickedCallback([=, symbol = symbol] { share(Ui::TokenQrForShare(symbol, link), QString()); });
+  // Only the latest click is delivered, the earlier requests are dropped with their lifetime.
+  const auto shareLifetime = button->lifetime().make_state<rpl::lifetime>();
+  const auto shareQr = [=, symbol = symbol] {
+    shareLifetime->destroy();
+    Ui::TokenQrForShareValue(symbol, link)  //
+        | rpl::take(1)                      //
+        | rpl::start_with_next([=](QImage image) { share(std::move(image), QString()); }, *shareLifetime);
+  };
+  button->setClickedCallback(shareQr);
+
+  Ui::TokenQrValue(symbol, link, pixel, max)  //
+      | rpl::start_with_next(
+            [=](QImage image) {
+              *qr = std::move(image);
+              button->update();
+            },
+            button->lifetime());
 
   button->paintRequest()  //
       | rpl::start_with_next(
             [=] {
-              const auto size = qr->width() / style::DevicePixelRatio();
-              QPainter(button).drawImage(QRect(0, 0, size, size), *qr);
+              auto p = QPainter(button);
+              if (qr->isNull()) {
+                PainterHighQualityEnabler hq(p);
+                p.setPen(Qt::NoPen);
+                p.setBrush(st::windowBgRipple);
+                p.drawRoundedRect(QRect(0, 0, size, size), st::roundRadiusLarge, st::roundRadiusLarge);
+              } else {
+                p.drawImage(QRect(0, 0, size, size), *qr);
+              }
             },
             button->lifetime());
 
   container->widthValue()  //
-      | rpl::start_with_next(
-            [=](int width) {
-              const auto size = qr->width() / style::DevicePixelRatio();
-              button->move((width - size) / 2, st::walletInvoiceQrSkip);
-            },
-            button->lifetime());
+      | rpl::start_with_next([=](int width) { button->move((width - size) / 2, st::walletInvoiceQrSkip); },
+                             button->lifetime());
 
   AddBoxSubtitle(box, ph::lng_wallet_invoice_qr_amount());
 
@@ -79,7 +99,7 @@ void InvoiceQrBox(not_null<Ui::GenericBox *> box, const QString &link, const Fn<
 
   box->addButton(
          ph::lng_wallet_invoice_qr_share(),
-         [=, symbol = symbol] { share(Ui::TokenQrForShare(symbol, link), QString()); }, st::walletBottomButton)
+         shareQr, st::walletBottomButton)
       ->setTextTransform(Ui::RoundButton::TextTransform::NoTransform);
 }
 
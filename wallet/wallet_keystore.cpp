@@ -14,6 +14,7 @@
 #include "wallet/wallet_common.h"
 #include "wallet/wallet_phrases.h"
 #include "wallet/create/wallet_create_view.h"
+#include "wallet/create/wallet_create_words.h"
 #include "base/platform/base_platform_layout_switch.h"
 #include "ton/ton_wallet.h"
 
@@ -23,11 +24,6 @@ namespace {
 
 using TonWordInput = Ui::TonWordInput;
 
-const base::flat_set<QString> &ValidWords() {
-  static auto words = Ton::Wallet::GetValidWords();
-  return words;
-}
-
 style::TextStyle ComputePubKeyStyle(const style::TextStyle &parent) {
   auto result = parent;
   result.font = result.font->monospace();
@@ -89,38 +85,6 @@ not_null<Ui::RpWidget *> CreatePubKeyLabel(not_null<Ui::RpWidget *> parent, rpl:
   return result;
 }
 
-std::vector<QString> WordsByPrefix(const QString &word) {
-  const auto &validWords = ValidWords();
-
-  const auto adjusted = word.trimmed().toLower();
-  if (adjusted.isEmpty()) {
-    return {};
-  } else if (validWords.empty()) {
-    return {word};
-  }
-  auto prefix = QString();
-  auto count = 0;
-  auto maxCount = 0;
-  for (const auto &validWord : validWords) {
-    if (validWord.midRef(0, 3) != prefix) {
-      prefix = validWord.mid(0, 3);
-      count = 1;
-    } else {
-      ++count;
-    }
-    if (maxCount < count) {
-      maxCount = count;
-    }
-  }
-  auto result = std::vector<QString>();
-  const auto from = ranges::lower_bound(validWords, adjusted);
-  const auto end = validWords.end();
-  for (auto i = from; i != end && i->startsWith(adjusted); ++i) {
-    result.push_back(*i);
-  }
-  return result;
-}
-
 }  // namespace
 
 class KeystoreItem {
@@ -359,9 +323,7 @@ void ImportFtabiKeyBox(not_null<Ui::GenericBox *> box, const Fn<void()> &cancel,
   const auto isValid = [=](int index) {
     Expects(index < count);
 
-    const auto word = (*inputs)[index]->word();
-    const auto words = WordsByPrefix(word);
-    return !words.empty() && (words.front() == word);
+    return Create::IsValidWord((*inputs)[index]->word());
   };
 
   const auto showError = [=](int index) {
@@ -435,7 +397,7 @@ void ImportFtabiKeyBox(not_null<Ui::GenericBox *> box, const Fn<void()> &cancel,
   };
 
   for (auto i = 0; i != count; ++i) {
-    inputs->push_back(std::make_unique<TonWordInput>(widget, st::walletImportInputField, i, WordsByPrefix));
+    inputs->push_back(std::make_unique<TonWordInput>(widget, st::walletImportInputField, i, Create::WordsByPrefix));
     init(*inputs->back(), i);
   }
 
@@ -119,6 +119,7 @@ phrase lng_wallet_empty_history_multisig_address = "Multisig wallet";
 phrase lng_wallet_history_receive_tokens = "Collect";
 phrase lng_wallet_history_execute_callback = "Execute";
 phrase lng_wallet_history_confirm = "Confirm";
+phrase lng_wallet_history_search = "Search by comment, address, amount or id";
 
 phrase lng_wallet_depool_info_title = "DePool Added";
 phrase lng_wallet_depool_info_stakes_title = "Stakes";
@@ -209,8 +210,17 @@ phrase lng_wallet_menu_settings = "Settings";
 phrase lng_wallet_menu_keystore = "Key storage";
 phrase lng_wallet_menu_change_passcode = "Change password";
 phrase lng_wallet_menu_export = "Back up wallet";
+phrase lng_wallet_menu_export_history = "Export history";
 phrase lng_wallet_menu_delete = "Log Out";
 
+phrase lng_wallet_export_history_title = "Export history";
+phrase lng_wallet_export_history_progress = "{count} transactions exported, {speed} per second...";
+phrase lng_wallet_export_history_done = "Done, {count} transactions exported.";
+phrase lng_wallet_export_history_failed = "Could not export the history.";
+phrase lng_wallet_export_history_save_title = "Save history as";
+phrase lng_wallet_export_history_csv_files = "CSV Files";
+phrase lng_wallet_export_history_json_files = "JSON Files";
+
 phrase lng_wallet_delete_title = "Log Out";
 phrase lng_wallet_delete_about =
     "This will disconnect the wallet from this app. You will be able to restore your wallet using **24 secret words** "
@@ -592,3 +602,23 @@ Fn<phrase(Ton::MultisigVersion)> lng_wallet_multisig_version = [](Ton::MultisigV
 };
 
 }  // namespace ph
+
+namespace Wallet {
+namespace {
+
+[[nodiscard]] rpl::event_stream<> &PhrasesUpdates() {
+  static auto result = rpl::event_stream<>();
+  return result;
+}
+
+}  // namespace
+
+void UpdatePhrases() {
+  PhrasesUpdates().fire({});
+}
+
+rpl::producer<> PhrasesUpdated() {
+  return PhrasesUpdates().events();
+}
+
+}  // namespace Wallet
@@ -118,6 +118,7 @@ extern phrase lng_wallet_empty_history_multisig_address;
 extern phrase lng_wallet_history_receive_tokens;
 extern phrase lng_wallet_history_execute_callback;
 extern phrase lng_wallet_history_confirm;
+extern phrase lng_wallet_history_search;
 
 extern phrase lng_wallet_depool_info_title;
 extern phrase lng_wallet_depool_info_stakes_title;
@@ -203,8 +204,17 @@ extern phrase lng_wallet_menu_settings;
 extern phrase lng_wallet_menu_keystore;
 extern phrase lng_wallet_menu_change_passcode;
 extern phrase lng_wallet_menu_export;
+extern phrase lng_wallet_menu_export_history;
 extern phrase lng_wallet_menu_delete;
 
+extern phrase lng_wallet_export_history_title;
+extern phrase lng_wallet_export_history_progress;
+extern phrase lng_wallet_export_history_done;
+extern phrase lng_wallet_export_history_failed;
+extern phrase lng_wallet_export_history_save_title;
+extern phrase lng_wallet_export_history_csv_files;
+extern phrase lng_wallet_export_history_json_files;
+
 extern phrase lng_wallet_delete_title;
 extern phrase lng_wallet_delete_about;
 extern phrase lng_wallet_delete_disconnect;
@@ -445,3 +455,12 @@ extern Fn<phrase(Ton::TokenVersion)> lng_wallet_token_version;
 extern Fn<phrase(Ton::MultisigVersion)> lng_wallet_multisig_version;
 
 }  // namespace ph
+
+namespace Wallet {
+
+// Called by the application after it replaced the phrases for a new language,
+// so that the texts built from them are built again.
+void UpdatePhrases();
+[[nodiscard]] rpl::producer<> PhrasesUpdated();
+
+}  // namespace Wallet
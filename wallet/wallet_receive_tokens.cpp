@@ -14,9 +14,11 @@
 #include "ui/widgets/checkbox.h"
 #include "ui/widgets/labels.h"
 #include "ui/widgets/buttons.h"
+#include "ui/painter.h"
 #include "qr/qr_generate.h"
 #include "styles/style_layers.h"
 #include "styles/style_wallet.h"
+#include "styles/palette.h"
 #include "wallet_common.h"
 
 namespace Wallet {
@@ -42,21 +44,42 @@ void ReceiveTokensBox(not_null<Ui::GenericBox *> box, RecipientWalletType type,
 
   const auto container = box->addRow(object_ptr<Ui::AbstractButton>(box));
 
-  container->setClickedCallback(
-      [=, symbol = symbol] { share(Ui::TokenQrForShare(symbol, TransferLink(rawAddress, symbol)), QString()); });
-
-  auto qr = container->lifetime().make_state<QImage>();
-
   const auto link = TransferLink(rawAddress, symbol);
-  *qr = Ui::TokenQr(symbol, link, st::walletReceiveQrPixel);
-  const auto size = qr->width() / style::DevicePixelRatio();
+
+  // Only the latest click is delivered, the earlier requests are dropped with their lifetime.
+  const auto shareLifetime = container->lifetime().make_state<rpl::lifetime>();
+  container->setClickedCallback([=, symbol = symbol] {
+    shareLifetime->destroy();
+    Ui::TokenQrForShareValue(symbol, link)  //
+        | rpl::take(1)                      //
+        | rpl::start_with_next([=](QImage image) { share(std::move(image), QString()); }, *shareLifetime);
+  });
+
+  const auto qr = container->lifetime().make_state<QImage>();
+  const auto size = Ui::TokenQrSize(link, st::walletReceiveQrPixel);
   container->resize(size, size);
 
+  Ui::TokenQrValue(symbol, link, st::walletReceiveQrPixel)  //
+      | rpl::start_with_next(
+            [=](QImage image) {
+              *qr = std::move(image);
+              container->update();
+            },
+            container->lifetime());
+
   container->paintRequest() |
       rpl::start_with_next(
           [=] {
-            const auto size = qr->width() / style::DevicePixelRatio();
-            QPainter(container).drawImage(QRect((container->width() - size) / 2, 0, size, size), *qr);
+            auto p = QPainter(container);
+            const auto rect = QRect((container->width() - size) / 2, 0, size, size);
+            if (qr->isNull()) {
+              PainterHighQualityEnabler hq(p);
+              p.setPen(Qt::NoPen);
+              p.setBrush(st::windowBgRipple);
+              p.drawRoundedRect(rect, st::roundRadiusLarge, st::roundRadiusLarge);
+            } else {
+              p.drawImage(rect, *qr);
+            }
           },
           container->lifetime());
 
@@ -79,7 +79,7 @@ void SendingDoneBox(not_null<Ui::GenericBox *> box, const Ton::Transaction &resu
 
   const auto inner = box->addRow(object_ptr<Ui::FixedHeightWidget>(box, AskPasswordBoxHeight()));
 
-  const auto lottie = inner->lifetime().make_state<Ui::LottieAnimation>(inner, Ui::LottieFromResource("done"));
+  const auto lottie = inner->lifetime().make_state<Ui::LottieAnimation>(inner, "done", st::walletSentLottieSize);
   lottie->start();
   lottie->stopOnLoop(1);
 
@@ -115,6 +115,7 @@ void TopBar::setupControls(rpl::producer<TopBarState> &&state) {
               const auto height = _widget.height();
 
               const auto isAssetSelected = state.selectedAsset.has_value();
+              _assetSelected = isAssetSelected;
               back->setVisible(isAssetSelected);
               broxus->setVisible(!isAssetSelected);
               if (isAssetSelected) {
@@ -162,6 +163,9 @@ void TopBar::showMenu(not_null<Ui::IconButton *> toggle) {
   menu->addAction(ph::lng_wallet_menu_keystore(ph::now), [=] { _actionRequests.fire(Action::ShowKeystore); });
   //menu->addAction(ph::lng_wallet_menu_change_passcode(ph::now), [=] { _actionRequests.fire(Action::ChangePassword); });
   //menu->addAction(ph::lng_wallet_menu_export(ph::now), [=] { _actionRequests.fire(Action::Export); });
+  if (_assetSelected) {
+    menu->addAction(ph::lng_wallet_menu_export_history(ph::now), [=] { _actionRequests.fire(Action::ExportHistory); });
+  }
   menu->addAction(ph::lng_wallet_menu_delete(ph::now), [=] { _actionRequests.fire(Action::LogOut); });
 
   _widgetParent->widthValue() |
@@ -46,6 +46,7 @@ class TopBar final {
   Ui::RpWidget _widget;
   rpl::event_stream<Action> _actionRequests;
   base::unique_qptr<Ui::DropdownMenu> _menu;
+  bool _assetSelected = false;
 };
 
 [[nodiscard]] rpl::producer<TopBarState> MakeTopBarState(rpl::producer<Ton::WalletViewerState> &&state,
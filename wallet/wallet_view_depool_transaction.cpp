@@ -70,13 +70,15 @@ object_ptr<Ui::RpWidget> CreateSummary(not_null<Ui::RpWidget *> parent, const To
 
 }  // namespace
 
-void ViewDePoolTransactionBox(not_null<Ui::GenericBox *> box, const Ton::Transaction &data,
+void ViewDePoolTransactionBox(not_null<Ui::GenericBox *> box, const TransactionPtr &transaction,
                               const Fn<void(QImage, QString)> &share) {
+  const auto &data = *transaction;
+
   box->setStyle(st::walletNoButtonsBox);
   box->addTopButton(st::boxTitleClose, [=] { box->closeBox(); });
 
   const auto id = data.id;
-  const auto address = Ton::Wallet::ConvertIntoRaw(ExtractAddress(data));
+  const auto address = RawAddress(ExtractAddress(data));
 
   v::match(
       data.additional,
@@ -2,13 +2,11 @@
 
 #include "ui/layers/generic_box.h"
 
-namespace Ton {
-struct Transaction;
-}
+#include "wallet_common.h"
 
 namespace Wallet {
 
-void ViewDePoolTransactionBox(not_null<Ui::GenericBox *> box, const Ton::Transaction &data,
+void ViewDePoolTransactionBox(not_null<Ui::GenericBox *> box, const TransactionPtr &transaction,
                               const Fn<void(QImage, QString)> &share);
 
 }  // namespace Wallet
@@ -210,7 +210,8 @@ void SetupScrollByDrag(not_null<Ui::BoxContent *> box, not_null<Ui::RpWidget *>
 
 }  // namespace
 
-void ViewTransactionBox(not_null<Ui::GenericBox *> box, Ton::Transaction &&data, const Ton::Symbol &selectedToken,
+void ViewTransactionBox(not_null<Ui::GenericBox *> box, const TransactionPtr &transaction,
+                        const Ton::Symbol &selectedToken,
                         rpl::producer<not_null<std::vector<Ton::Transaction> *>> collectEncrypted,
                         rpl::producer<not_null<const std::vector<Ton::Transaction> *>> decrypted,
                         const Fn<void(QImage, QString)> &share, const Fn<void(const QString &)> &viewInExplorer,
@@ -223,6 +224,8 @@ void ViewTransactionBox(not_null<Ui::GenericBox *> box, Ton::Transaction &&data,
     bool success = false;
   };
 
+  const auto &data = *transaction;
+
   auto tokenTransaction = selectedToken.isToken() ? TryGetTokenTransaction(data, selectedToken) : std::nullopt;
   auto notification = TryGetNotification(data);
   const auto isTokenTransaction = tokenTransaction.has_value();
@@ -235,17 +238,17 @@ void ViewTransactionBox(not_null<Ui::GenericBox *> box, Ton::Transaction &&data,
     if (isTokenTransaction) {
       if (shouldWaitRecipient) {
         return resolvedAddress->events() |
-               rpl::map([](QString &&address) { return Ton::Wallet::ConvertIntoRaw(address); });
+               rpl::map([](QString &&address) { return RawAddress(address); });
       } else if (emptyAddress) {
         return rpl::single(QString{});
       } else {
         return rpl::single(tokenTransaction->swapback  //
                                ? tokenTransaction->recipient
-                               : Ton::Wallet::ConvertIntoRaw(tokenTransaction->recipient));
+                               : RawAddress(tokenTransaction->recipient));
       }
     } else {
       const auto address = ExtractAddress(data);
-      return rpl::single(address.isEmpty() ? address : Ton::Wallet::ConvertIntoRaw(address));
+      return rpl::single(address.isEmpty() ? address : RawAddress(address));
     }
   }();
 
@@ -354,7 +357,7 @@ void ViewTransactionBox(not_null<Ui::GenericBox *> box, Ton::Transaction &&data,
 
       std::move(collectEncrypted)  //
           | rpl::take(1)           //
-          | rpl::start_with_next([=](not_null<std::vector<Ton::Transaction> *> list) { list->push_back(data); },
+          | rpl::start_with_next([=](not_null<std::vector<Ton::Transaction> *> list) { list->push_back(*transaction); },
                                  comment->lifetime());
 
       comment->setClickHandlerFilter([=](const auto &...) {
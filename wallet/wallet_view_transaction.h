@@ -8,14 +8,12 @@
 
 #include "ui/layers/generic_box.h"
 
-namespace Ton {
-struct Transaction;
-class Symbol;
-}  // namespace Ton
+#include "wallet_common.h"
 
 namespace Wallet {
 
-void ViewTransactionBox(not_null<Ui::GenericBox *> box, Ton::Transaction &&data, const Ton::Symbol &selectedToken,
+void ViewTransactionBox(not_null<Ui::GenericBox *> box, const TransactionPtr &transaction,
+                        const Ton::Symbol &selectedToken,
                         rpl::producer<not_null<std::vector<Ton::Transaction> *>> collectEncrypted,
                         rpl::producer<not_null<const std::vector<Ton::Transaction> *>> decrypted,
                         const Fn<void(QImage, QString)> &share, const Fn<void(const QString &)> &viewInExplorer,
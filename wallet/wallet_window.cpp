@@ -29,6 +29,7 @@
 #include "wallet/wallet_delete.h"
 #include "wallet/wallet_export.h"
 #include "wallet/wallet_update_info.h"
+#include "wallet/wallet_history_cache.h"
 #include "wallet/wallet_settings.h"
 #include "wallet/create/wallet_create_manager.h"
 #include "ton/ton_wallet.h"
@@ -50,7 +51,6 @@
 
 #include <QtCore/QMimeData>
 #include <QtCore/QDir>
-#include <QtCore/QRegularExpression>
 #include <QtGui/QtEvents>
 #include <QtGui/QClipboard>
 #include <QtGui/QGuiApplication>
@@ -58,6 +58,7 @@
 #include <QtGui/QDesktopServices>
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QDesktopWidget>
+#include <QtWidgets/QFileDialog>
 
 namespace Wallet {
 namespace {
@@ -66,21 +67,14 @@ constexpr auto kRefreshEachDelay = 10 * crl::time(1000);
 constexpr auto kRefreshInactiveDelay = 60 * crl::time(1000);
 constexpr auto kRefreshWhileSendingDelay = 3 * crl::time(1000);
 
-[[nodiscard]] bool ValidateTransferLink(const QString &link) {
-  return QRegularExpression(
-             QString(R"(^((freeton:\/\/)?(transfer|stake)\/)?[A-Za-z0-9_\-]{%1}\/?($|\?))").arg(kEncodedAddressLength),
-             QRegularExpression::CaseInsensitiveOption)
-      .match(link.trimmed())
-      .hasMatch();
-}
-
 }  // namespace
 
-Window::Window(not_null<Ton::Wallet *> wallet, UpdateInfo *updateInfo)
+Window::Window(not_null<Ton::Wallet *> wallet, UpdateInfo *updateInfo, HistoryCache *historyCache)
     : _wallet(wallet)
     , _window(std::make_unique<Ui::Window>())
     , _layers(std::make_unique<Ui::LayerManager>(_window->body()))
     , _updateInfo(updateInfo)
+    , _historyCache(historyCache)
     , _selectedAsset(std::nullopt) {
   init();
   const auto keys = _wallet->publicKeys();
@@ -370,6 +364,9 @@ void Window::showAccount(const QByteArray &publicKey, bool justCreated) {
 
   _packedAddress = _wallet->getUsedAddress(publicKey);
   _rawAddress = Ton::Wallet::ConvertIntoRaw(_packedAddress);
+  if (_historyCache) {
+    _historyCache->setAccount(_rawAddress, _wallet->settings().useTestNetwork);
+  }
   _viewer = _wallet->createAccountViewer(publicKey, _packedAddress);
   _state = _viewer->state() | rpl::map([](Ton::WalletViewerState &&state) { return std::move(state.wallet); });
   _syncing = false;
@@ -383,7 +380,10 @@ void Window::showAccount(const QByteArray &publicKey, bool justCreated) {
   _window->setTitleStyle(st::walletWindowTitle);
   Info::Data data{
       .state = _viewer->state(),
-      .loaded = _viewer->loaded(),
+      .loaded = _viewer->loaded()  //
+                | rpl::before_next([=](const Ton::Result<std::pair<HistoryPageKey, Ton::LoadedSlice>> &value) {
+                    takeHistoryExportSlice(value);
+                  }),
       .updates = _wallet->updates(),
       .collectEncrypted = _collectEncryptedRequests.events(),
       .updateDecrypted = _decrypted.events(),
@@ -392,6 +392,7 @@ void Window::showAccount(const QByteArray &publicKey, bool justCreated) {
       .transitionEvents = _infoTransitions.events(),
       .share = shareAddressCallback(),
       .openGate = [this] { _wallet->openGate(_rawAddress); },
+      .historyCache = _historyCache,
       .justCreated = justCreated,
       .useTestNetwork = _wallet->settings().useTestNetwork,
   };
@@ -424,6 +425,9 @@ void Window::showAccount(const QByteArray &publicKey, bool justCreated) {
                 case Action::Export:
                   askExportPassword();
                   return;
+                case Action::ExportHistory:
+                  exportHistory();
+                  return;
                 case Action::Send:
                   v::match(
                       _selectedAsset.current().value_or(SelectedToken::defaultToken()),
@@ -563,21 +567,7 @@ void Window::showAccount(const QByteArray &publicKey, bool justCreated) {
 
   _info->preloadRequests()  //
       | rpl::start_with_next(
-            [=](const std::pair<HistoryPageKey, Ton::TransactionId> &id) {
-              const auto [symbol, account] = id.first;
-
-              if (symbol.isTon() && account.isEmpty()) {
-                _viewer->preloadSlice(id.second);
-              } else if (symbol.isTon()) {
-                _viewer->preloadAccountSlice(account, id.second);
-              } else {
-                const auto state = _state.current();
-                const auto it = state.tokenStates.find(symbol);
-                if (it != end(state.tokenStates)) {
-                  _viewer->preloadTokenSlice(symbol, it->second.walletContractAddress, id.second);
-                }
-              }
-            },
+            [=](const std::pair<HistoryPageKey, Ton::TransactionId> &id) { preloadHistory(id.first, id.second); },
             _info->lifetime());
 
   _info->ownerResolutionRequests()  //
@@ -714,7 +704,7 @@ void Window::showAccount(const QByteArray &publicKey, bool justCreated) {
 
   _info->viewRequests() |
       rpl::start_with_next(
-          [=](Ton::Transaction &&data) {
+          [=](const TransactionPtr &data) {
             const auto selectedAsset = _selectedAsset.current().value_or(SelectedToken::defaultToken());
 
             v::match(
@@ -749,17 +739,17 @@ void Window::showAccount(const QByteArray &publicKey, bool justCreated) {
                       this, [=](const QString &eventAddress) { _wallet->openGateExecuteSwapBack(eventAddress); });
 
                   _layers->showBox(Box(
-                      ViewTransactionBox, std::move(data), selectedToken.symbol, _collectEncryptedRequests.events(),
+                      ViewTransactionBox, data, selectedToken.symbol, _collectEncryptedRequests.events(),
                       _decrypted.events(), shareAddressCallback(),
                       [=](const QString &transactionHash) { openInExplorer(transactionHash); },
                       [=] { decryptEverything(publicKey); }, resolveOwner, send, collect, execute));
                 },
                 [&](const SelectedDePool &selectedDePool) {
-                  _layers->showBox(Box(ViewDePoolTransactionBox, std::move(data), shareAddressCallback()));
+                  _layers->showBox(Box(ViewDePoolTransactionBox, data, shareAddressCallback()));
                 },
                 [&](const SelectedMultisig &selectedMultisig) {
                   _layers->showBox(Box(
-                      ViewTransactionBox, std::move(data), Ton::Symbol::ton(), _collectEncryptedRequests.events(),
+                      ViewTransactionBox, data, Ton::Symbol::ton(), _collectEncryptedRequests.events(),
                       _decrypted.events(), shareAddressCallback(),
                       [=](const QString &transactionHash) { openInExplorer(transactionHash); },
                       [=] { decryptEverything(publicKey); },
@@ -940,7 +930,7 @@ not_null<Ui::RpWidget *> Window::widget() const {
 }
 
 bool Window::handleLinkOpen(const QString &link) {
-  if (_viewer && ValidateTransferLink(link)) {
+  if (_viewer && IsTransferLink(link)) {
     sendMoney(link);
   }
   return true;
@@ -1818,7 +1808,7 @@ void Window::addAsset() {
 }
 
 void Window::receiveTokens(RecipientWalletType type, const QString &address, const Ton::Symbol &symbol) {
-  const auto rawAddress = Ton::Wallet::ConvertIntoRaw(address);
+  const auto rawAddress = RawAddress(address);
 
   _layers->showBox(Box(
       ReceiveTokensBox, type, rawAddress, symbol, [=] { createInvoice(symbol); }, shareAddressCallback(),
@@ -2567,6 +2557,81 @@ void Window::showExported(const std::vector<QString> &words) {
   _layers->showBox(Box(ExportedBox, words));
 }
 
+void Window::preloadHistory(const HistoryPageKey &page, const Ton::TransactionId &id) {
+  const auto &[symbol, account] = page;
+  if (symbol.isTon() && account.isEmpty()) {
+    _viewer->preloadSlice(id);
+  } else if (symbol.isTon()) {
+    _viewer->preloadAccountSlice(account, id);
+  } else {
+    const auto state = _state.current();
+    const auto it = state.tokenStates.find(symbol);
+    if (it != end(state.tokenStates)) {
+      _viewer->preloadTokenSlice(symbol, it->second.walletContractAddress, id);
+    }
+  }
+}
+
+void Window::exportHistory() {
+  const auto page = v::match(
+      _selectedAsset.current().value_or(SelectedToken::defaultToken()),
+      [](const SelectedToken &selectedToken) { return HistoryPageKey(selectedToken.symbol, QString()); },
+      [](const SelectedDePool &) { return HistoryPageKey(Ton::Symbol::ton(), QString()); },
+      [](const SelectedMultisig &selectedMultisig) {
+        return HistoryPageKey(Ton::Symbol::ton(), selectedMultisig.address);
+      });
+
+  const auto state = _state.current();
+  auto latest = Ton::TransactionsSlice();
+  if (page.first.isToken()) {
+    const auto it = state.tokenStates.find(page.first);
+    if (it == end(state.tokenStates)) {
+      return;
+    }
+    latest = it->second.lastTransactions;
+  } else if (!page.second.isEmpty()) {
+    const auto it = state.multisigStates.find(page.second);
+    if (it == end(state.multisigStates)) {
+      return;
+    }
+    latest = it->second.lastTransactions;
+  } else {
+    latest = state.lastTransactions;
+  }
+
+  const auto csvFilter = ph::lng_wallet_export_history_csv_files(ph::now) + " (*.csv)";
+  const auto jsonFilter = ph::lng_wallet_export_history_json_files(ph::now) + " (*.json)";
+  auto selectedFilter = QString();
+  auto path = QFileDialog::getSaveFileName(_window.get(), ph::lng_wallet_export_history_save_title(ph::now),
+                                           QString(), csvFilter + ";;" + jsonFilter, &selectedFilter);
+  if (path.isEmpty()) {
+    return;
+  }
+  const auto format = (selectedFilter == jsonFilter) ? HistoryExportFormat::Json : HistoryExportFormat::Csv;
+  const auto extension = (format == HistoryExportFormat::Json) ? qstr(".json") : qstr(".csv");
+  if (!path.endsWith(extension, Qt::CaseInsensitive)) {
+    path += extension;
+  }
+  const auto history = std::make_shared<HistoryExport>(
+      page, path, format,
+      crl::guard(this, [=](const HistoryPageKey &page, const Ton::TransactionId &id) { preloadHistory(page, id); }));
+  _historyExport = history;
+  _layers->showBox(Box(HistoryExportBox, history));
+  history->start(latest);
+}
+
+void Window::takeHistoryExportSlice(const Ton::Result<std::pair<HistoryPageKey, Ton::LoadedSlice>> &value) {
+  // The slice goes on to the history list as well, it may be waiting for the same one.
+  const auto history = _historyExport.lock();
+  if (!history) {
+    return;
+  } else if (!value) {
+    history->retry();
+  } else if (history->waits(value->first, value->second)) {
+    history->apply(value->second);
+  }
+}
+
 void Window::logoutWithConfirmation() {
   _layers->showBox(Box(DeleteWalletBox, [=] { logout(); }));
 }
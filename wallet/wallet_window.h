@@ -45,12 +45,15 @@ class Info;
 struct StakeInvoice;
 enum class InvoiceField;
 class UpdateInfo;
+class HistoryCache;
+class HistoryExport;
 enum class InfoTransition;
 using PreparedInvoiceOrLink = std::variant<PreparedInvoice, QString>;
+using HistoryPageKey = std::pair<Ton::Symbol, QString>;
 
 class Window final : public base::has_weak_ptr {
  public:
-  Window(not_null<Ton::Wallet *> wallet, UpdateInfo *updateInfo = nullptr);
+  Window(not_null<Ton::Wallet *> wallet, UpdateInfo *updateInfo = nullptr, HistoryCache *historyCache = nullptr);
   ~Window();
 
   void showAndActivate();
@@ -118,6 +121,9 @@ class Window final : public base::has_weak_ptr {
   void changePassword();
   void askExportPassword();
   void showExported(const std::vector<QString> &words);
+  void preloadHistory(const HistoryPageKey &page, const Ton::TransactionId &id);
+  void exportHistory();
+  void takeHistoryExportSlice(const Ton::Result<std::pair<HistoryPageKey, Ton::LoadedSlice>> &value);
   void showSettings();
   void checkConfigFromContent(QByteArray bytes, Fn<void(QByteArray)> good);
   void saveSettings(const Ton::Settings &settings);
@@ -165,6 +171,8 @@ class Window final : public base::has_weak_ptr {
   const std::unique_ptr<Ui::Window> _window;
   const std::unique_ptr<Ui::LayerManager> _layers;
   UpdateInfo *const _updateInfo = nullptr;
+  HistoryCache *const _historyCache = nullptr;
+  std::weak_ptr<HistoryExport> _historyExport;
 
   std::unique_ptr<Create::Manager> _createManager;
   rpl::event_stream<QString> _createSyncing;